@@ -26,7 +26,7 @@ public class MuJoCoUE : ModuleRules
 		PublicDependencyModuleNames.AddRange(
 			new string[]
 			{
-				"Core", "ProceduralMeshComponent",
+				"Core", "ProceduralMeshComponent", "MeshDescription",
 				// ... add other public dependencies that you statically link with here ...
 			}
 			);
@@ -37,6 +37,9 @@ public class MuJoCoUE : ModuleRules
 			{
 				"CoreUObject",
 				"Engine",
+				"RenderCore",
+				"RHI",
+				"StaticMeshDescription",
 				"Slate",
 				"SlateCore",
 				"Projects", 
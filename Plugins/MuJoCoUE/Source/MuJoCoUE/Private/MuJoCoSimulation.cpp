@@ -1,12 +1,19 @@
 ﻿// Fill out your copyright notice in the Description page of Project Settings.
 
 #include "MuJoCoSimulation.h"
+#include "MujocoSimulationSubsystem.h"
+#include "MujocoPoseConversion.h"
+#include "MujocoMeshConversion.h"
+#include "MujocoMeshCache.h"
 
 #include "mujoco/mujoco.h"
 #include <vector>
 #include <string>
 
-#include "KismetProceduralMeshLibrary.h"
+#include "Kismet/GameplayStatics.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+#include "SceneManagement.h"
 #include "ProceduralMeshConversion.h"
 
 FVector CalculateWorldPosition(const FVector &BaseLocation, const FQuat &BaseRotation, const FVector &RelativeLocation)
@@ -126,105 +133,309 @@ void AMuJoCoSimulation::GenerateMeshes(ModelInfo &modelInfo)
 
 	BodyMap.Empty();
 	GeomMap1.Empty();
+	BodyComponents.Init(nullptr, modelInfo.bodies.size());
+	GeomComponents.Init(nullptr, modelInfo.geoms.size());
 
 	// Generate body componenets
 	int BodyId = 0;
+	const bool bFlat = bFlatComponentLayout;
 	for (const BodyInfo &bodyInfo : modelInfo.bodies)
 	{
+		if (bFlat && !bCreateBodyComponents)
+			break;
 
 		USceneComponent *sceneComponent = NewObject<USceneComponent>(this, FName(*(FString(bodyInfo.name.c_str()) + *FString::Printf(TEXT("_Body%d"), BodyId))));
 
+		BodyComponents[BodyId] = sceneComponent;
 		BodyMap.Add(BodyId++, sceneComponent);
 		sceneComponent->RegisterComponent();
 		sceneComponent->SetRelativeLocation(FVector(bodyInfo.pos[0] * 100, bodyInfo.pos[1] * 100, bodyInfo.pos[2] * 100));
 		sceneComponent->SetRelativeRotation(bodyInfo.quat2);
-		if (bodyInfo.parent_id == 0)
+		if (bodyInfo.parent_id == 0 || bFlat)
 			sceneComponent->AttachToComponent(GetRootComponent(), FAttachmentTransformRules::KeepRelativeTransform);
 		else
 		{
-			USceneComponent *parentComponent = BodyMap[bodyInfo.parent_id];
+			USceneComponent *parentComponent = BodyComponents[bodyInfo.parent_id];
 			sceneComponent->AttachToComponent(parentComponent, FAttachmentTransformRules::KeepRelativeTransform);
 		}
 	}
 
+	if (bBatchTransformUpdates)
+	{
+		// World transforms are written directly; keep them from being re-derived through the parents.
+		// The world body (0) stays relative so it follows the actor root.
+		for (int32 i = 1; i < BodyComponents.Num(); ++i)
+		{
+			if (BodyComponents[i])
+				BodyComponents[i]->SetAbsolute(true, true, true);
+		}
+	}
+
+	if (GeomRenderMode == EMujocoGeomRenderMode::InstancedMeshes)
+	{
+		GenerateInstancedGeoms(modelInfo);
+		return;
+	}
+	if (GeomRenderMode == EMujocoGeomRenderMode::SingleProxy)
+	{
+		GenerateModelComponent(modelInfo);
+		return;
+	}
+
 	// Generate geom meshes
 	int GeomId = 0;
 	for (GeomInfo &geomInfo : modelInfo.geoms)
 	{
+		if (!IsGeomGroupVisible(GeomId))
+		{
+			GeomId++;
+			continue;
+		}
 		// Create a new mesh component
 		UStaticMeshComponent *staticMeshComponent = NewObject<UStaticMeshComponent>(this);//, FName(*(FString(geomInfo.name.c_str()) + *FString::Printf(TEXT("_Geom%d"), BodyId))));
 		staticMeshComponent->RegisterComponent();
 		geomInfo.posAdjust[2] = geomInfo.size[2] * -50;
 		staticMeshComponent->SetRelativeLocation(FVector(geomInfo.pos[0] * 100, geomInfo.pos[1] * 100, geomInfo.pos[2] * 100)); //+geomInfo.posAdjust[2]
 		staticMeshComponent->SetRelativeRotation(geomInfo.quat2);
-		staticMeshComponent->AttachToComponent(this->BodyMap[geomInfo.body_id], FAttachmentTransformRules::KeepRelativeTransform);
-		;
+		if (bFlat)
+			staticMeshComponent->AttachToComponent(GetRootComponent(), FAttachmentTransformRules::KeepRelativeTransform);
+		else
+			staticMeshComponent->AttachToComponent(BodyComponents[geomInfo.body_id], FAttachmentTransformRules::KeepRelativeTransform);
+
 		// Get mesh for this geometry
-		auto *mesh = MeshAssets.Find(geomInfo.type) ? MeshAssets[geomInfo.type] : nullptr;
-		// Generate Procedural Mesh if type = mesh
-		if (!mesh)
-		{
-			if (geomInfo.type == mjGEOM_MESH && mModel->geom_dataid[GeomId] != -1)
-			{
-				int meshId = mModel->geom_dataid[GeomId];
-				if (meshId >= 0 && meshId < ProceduralMeshes.Num())
-				{
-					UProceduralMeshComponent *procMesh = ProceduralMeshes[meshId];
-
-					const FMeshDescription description = BuildMeshDescription(procMesh);
-					TArray<const FMeshDescription *> descs;
-					descs.Add(&description);
-
-					UStaticMesh *NewStaticMesh = NewObject<UStaticMesh>(staticMeshComponent);
-					NewStaticMesh->AddMaterial(procMesh->GetMaterial(0));
-					NewStaticMesh->BuildFromMeshDescriptions(descs);
-					staticMeshComponent->SetStaticMesh(NewStaticMesh);
-					mesh = NewStaticMesh;
-					if (mesh)
-					{
-						geomInfo.size[0] = 1;
-						geomInfo.size[1] = 1;
-						geomInfo.size[2] = 1;
-					}
-				}
-			}
-			if (!mesh)
-				mesh = defaultMesh;
-		}
+		UStaticMesh *mesh = GetGeomMesh(GeomId, geomInfo);
 
 		staticMeshComponent->SetStaticMesh(mesh);
 		SetMeshColor(staticMeshComponent, geomInfo.color);
 		staticMeshComponent->SetSimulatePhysics(false);
 		staticMeshComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 		staticMeshComponent->SetWorldScale3D(FVector(geomInfo.size[0], geomInfo.size[1], geomInfo.size[2]));
+		if (bBatchTransformUpdates)
+			staticMeshComponent->SetAbsolute(true, true, true);
 
+		GeomComponents[GeomId] = staticMeshComponent;
 		this->GeomMap1.Add(GeomId++, staticMeshComponent);
 	}
 }
 
-void AMuJoCoSimulation::ExtractCurrentState(ModelInfo &info)
+UStaticMesh *AMuJoCoSimulation::GetGeomMesh(int GeomId, GeomInfo &geomInfo)
 {
+	auto *mesh = MeshAssets.Find(geomInfo.type) ? MeshAssets[geomInfo.type] : nullptr;
+	// Generate Procedural Mesh if type = mesh
+	if (!mesh)
+	{
+		if (geomInfo.type == mjGEOM_MESH && mModel->geom_dataid[GeomId] != -1)
+		{
+			int meshId = mModel->geom_dataid[GeomId];
+			if (meshId >= 0 && meshId < mModel->nmesh)
+			{
+				mesh = GetSharedMesh(meshId);
+				if (mesh)
+				{
+					geomInfo.size[0] = 1;
+					geomInfo.size[1] = 1;
+					geomInfo.size[2] = 1;
+				}
+			}
+		}
+		if (!mesh)
+			mesh = defaultMesh;
+	}
+	return mesh;
+}
 
-	for (int i = 0; i < mModel->nbody; ++i)
+UStaticMesh *AMuJoCoSimulation::GetSharedMesh(int MeshId)
+{
+	if (UStaticMesh *cached = MeshCache[MeshId])
+		return cached;
+
+	// Another simulation in this world may already have built the same mesh
+	UMujocoSimulationSubsystem *subsystem = GetWorld() ? GetWorld()->GetSubsystem<UMujocoSimulationSubsystem>() : nullptr;
+	const uint64 hash = MujocoMeshConversion::HashMesh(mModel, MeshId);
+	UStaticMesh *mesh = subsystem ? subsystem->FindSharedMesh(hash) : nullptr;
+	if (!mesh)
 	{
-		// Get positional data from global coordinates (xpos and xquat)
-		BodyInfo bodyInfo;
-		std::copy(mData->xpos + 3 * i, mData->xpos + 3 * (i + 1), info.bodies[i].pos);
-		std::copy(mData->xquat + 4 * i, mData->xquat + 4 * (i + 1), info.bodies[i].quat);
-		info.bodies[i].quat2 = FQuat(info.bodies[i].quat[1], info.bodies[i].quat[2], info.bodies[i].quat[3], info.bodies[i].quat[0]);
+		// Owned by the subsystem when shared, so it outlives this actor
+		mesh = BuildStaticMesh(MeshId, subsystem ? static_cast<UObject *>(subsystem) : this);
+		if (mesh && subsystem)
+			subsystem->AddSharedMesh(hash, mesh);
 	}
+	MeshCache[MeshId] = mesh;
+	return mesh;
+}
 
-	// Update geom states
-	for (int i = 0; i < mModel->ngeom; ++i)
-	{   GeomInfo& geomInfo=info.geoms[i];
-		std::copy(mData->geom_xpos + 3 * i, mData->geom_xpos + 3 * (i + 1), info.geoms[i].pos);
-		// Convert rotation matrix to quaternion
-		const mjtNum *mat = mData->geom_xmat + 9 * i;
-		mjtNum quat[4];
-		mju_mat2Quat(quat, mat);
+UStaticMesh *AMuJoCoSimulation::BuildStaticMesh(int MeshId, UObject *Outer)
+{
+	FMeshDescription procDescription;
+	const FMeshDescription *description = nullptr;
+	UMaterialInterface *material = nullptr;
+	if (MeshDescriptions.IsValidIndex(MeshId) && !MeshDescriptions[MeshId].IsEmpty())
+		description = &MeshDescriptions[MeshId];
+	else if (ProceduralMeshes.IsValidIndex(MeshId) && ProceduralMeshes[MeshId])
+	{
+		UProceduralMeshComponent *procMesh = ProceduralMeshes[MeshId];
+		procDescription = BuildMeshDescription(procMesh);
+		description = &procDescription;
+		material = procMesh->GetMaterial(0);
+	}
+	if (!description)
+		return nullptr;
+
+	TArray<const FMeshDescription *> descs;
+	descs.Add(description);
+	// Only the render data is needed: no collision, no CPU copy kept in the asset
+	UStaticMesh::FBuildMeshDescriptionsParams params;
+	params.bBuildSimpleCollision = false;
+	params.bCommitMeshDescription = false;
+	params.bFastBuild = true;
+
+	UStaticMesh *NewStaticMesh = NewObject<UStaticMesh>(Outer);
+	NewStaticMesh->AddMaterial(material);
+	NewStaticMesh->BuildFromMeshDescriptions(descs, params);
+	return NewStaticMesh;
+}
+
+void AMuJoCoSimulation::GenerateInstancedGeoms(ModelInfo &modelInfo)
+{
+	InstancedGeomGroups.Empty();
+	InstancedGroupTransforms.Empty();
+	GeomInstances.Init(FIntPoint(INDEX_NONE, INDEX_NONE), modelInfo.geoms.size());
+
+	TMap<TPair<UStaticMesh *, UMaterialInterface *>, int32> groupLookup;
+	int GeomId = 0;
+	for (GeomInfo &geomInfo : modelInfo.geoms)
+	{
+		const int geomId = GeomId++;
+		if (!IsGeomGroupVisible(geomId))
+			continue;
+		UStaticMesh *mesh = GetGeomMesh(geomId, geomInfo);
+		if (!mesh)
+			continue;
+		UMaterialInterface *material = InstancedMaterial ? InstancedMaterial : mesh->GetMaterial(0);
+
+		int32 *group = groupLookup.Find(TPair<UStaticMesh *, UMaterialInterface *>(mesh, material));
+		if (!group)
+		{
+			UInstancedStaticMeshComponent *instanced = NewObject<UInstancedStaticMeshComponent>(this);
+			instanced->SetStaticMesh(mesh);
+			instanced->SetMaterial(0, material);
+			instanced->NumCustomDataFloats = 4;
+			instanced->SetSimulatePhysics(false);
+			instanced->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+			instanced->SetupAttachment(GetRootComponent());
+			instanced->RegisterComponent();
+			group = &groupLookup.Add(TPair<UStaticMesh *, UMaterialInterface *>(mesh, material), InstancedGeomGroups.Add(instanced));
+			InstancedGroupTransforms.AddDefaulted();
+		}
+
+		UInstancedStaticMeshComponent *instanced = InstancedGeomGroups[*group];
+		const FTransform transform(FQuat::Identity, GetActorLocation(), FVector(geomInfo.size[0], geomInfo.size[1], geomInfo.size[2]));
+		const int32 instance = instanced->AddInstance(transform, true);
+		const float color[4] = {geomInfo.color.R, geomInfo.color.G, geomInfo.color.B, geomInfo.color.A};
+		instanced->SetCustomData(instance, MakeArrayView(color, 4));
+		InstancedGroupTransforms[*group].Add(transform);
+		GeomInstances[geomId] = FIntPoint(*group, instance);
+	}
+}
+
+void AMuJoCoSimulation::GenerateModelComponent(ModelInfo &modelInfo)
+{
+	TArray<FMujocoModelGeom> geoms;
+	geoms.Reserve(modelInfo.geoms.size());
+	int GeomId = 0;
+	for (GeomInfo &geomInfo : modelInfo.geoms)
+	{
+		const int geomId = GeomId++;
+		if (!IsGeomGroupVisible(geomId))
+			continue;
+		UStaticMesh *mesh = GetGeomMesh(geomId, geomInfo);
+		if (!mesh)
+			continue;
+		FMujocoModelGeom &geom = geoms.AddDefaulted_GetRef();
+		geom.Mesh = mesh;
+		geom.Scale = FVector(geomInfo.size[0], geomInfo.size[1], geomInfo.size[2]);
+		geom.Color = geomInfo.color;
+		geom.GeomId = geomId;
+	}
+
+	// Poses are relative to the actor, so the component sits on the root with an identity transform
+	ModelComponent = NewObject<UMujocoModelComponent>(this);
+	ModelComponent->SetupAttachment(GetRootComponent());
+	ModelComponent->SetGeoms(geoms);
+	ModelComponent->RegisterComponent();
+}
+
+double AMuJoCoSimulation::GetInterpolationAlpha(const FMujocoStateSnapshot &Snapshot) const
+{
+	// No blending without a previous step, after a reset, or when not paced against wall time
+	const double simInterval = Snapshot.Time - Snapshot.PreviousTime;
+	if (!bInterpolatePoses || !Snapshot.HasPrevious() || simInterval <= 0)
+		return 1;
+	// Fixed-step modes publish right before the poses are extracted: show that step as is, so
+	// rendering neither lags a step behind nor depends on wall-clock jitter
+	if (StepMode == EMujocoStepMode::Lockstep || StepMode == EMujocoStepMode::Pipelined)
+		return 1;
+	// The worker's pace, which the SlowClock lag policy may hold below RealTimeFactor
+	const float factor = WorkerRunnable ? WorkerRunnable->GetLagStats().EffectiveRealTimeFactor : RealTimeFactor;
+	if (factor <= 0)
+		return 1;
+	const double wallInterval = simInterval / factor;
+	return FMath::Clamp((FPlatformTime::Seconds() - Snapshot.PublishTime) / wallInterval, 0.0, 1.0);
+}
+
+void AMuJoCoSimulation::ExtractCurrentState(FMujocoPoseBuffer &Poses)
+{
+	const FMujocoStateSnapshot &snapshot = SnapshotBuffer.AcquireLatest();
+	if (snapshot.BodyXPos.Num() != Poses.NumBodies() * 3 || snapshot.GeomXPos.Num() != Poses.NumGeoms() * 3)
+		return;
+
+	const double alpha = GetInterpolationAlpha(snapshot);
+	if (alpha < 1)
+	{
+		// Both steps go through the batch kernels, then are blended pose by pose
+		const int32 numBodies = Poses.NumBodies();
+		const int32 numGeoms = Poses.NumGeoms();
+		const int32 count = FMath::Max(numBodies, numGeoms);
+		for (int32 step = 0; step < 2; ++step)
+		{
+			InterpolationPositions[step].SetNumUninitialized(count);
+			InterpolationRotations[step].SetNumUninitialized(count);
+		}
 
-		geomInfo.quat2 = FQuat(quat[1], quat[2], quat[3], quat[0]);
+		MujocoPoseConversion::ConvertPositions(snapshot.PrevBodyXPos.GetData(), InterpolationPositions[0].GetData(), numBodies);
+		MujocoPoseConversion::ConvertPositions(snapshot.BodyXPos.GetData(), InterpolationPositions[1].GetData(), numBodies);
+		MujocoPoseConversion::ConvertQuats(snapshot.PrevBodyXQuat.GetData(), InterpolationRotations[0].GetData(), numBodies);
+		MujocoPoseConversion::ConvertQuats(snapshot.BodyXQuat.GetData(), InterpolationRotations[1].GetData(), numBodies);
+		for (int32 i = 0; i < numBodies; ++i)
+			Poses.SetBody(i, FMath::Lerp(InterpolationPositions[0][i], InterpolationPositions[1][i], alpha),
+						  FQuat::Slerp(InterpolationRotations[0][i], InterpolationRotations[1][i], alpha));
+
+		MujocoPoseConversion::ConvertPositions(snapshot.PrevGeomXPos.GetData(), InterpolationPositions[0].GetData(), numGeoms);
+		MujocoPoseConversion::ConvertPositions(snapshot.GeomXPos.GetData(), InterpolationPositions[1].GetData(), numGeoms);
+		MujocoPoseConversion::ConvertMatrices(snapshot.PrevGeomXMat.GetData(), InterpolationRotations[0].GetData(), numGeoms);
+		MujocoPoseConversion::ConvertMatrices(snapshot.GeomXMat.GetData(), InterpolationRotations[1].GetData(), numGeoms);
+		for (int32 i = 0; i < numGeoms; ++i)
+			Poses.SetGeom(i, FMath::Lerp(InterpolationPositions[0][i], InterpolationPositions[1][i], alpha),
+						  FQuat::Slerp(InterpolationRotations[0][i], InterpolationRotations[1][i], alpha));
+		// Blended poses are compared one by one above; what is shown now is at least the previous step
+		LastAppliedPublishIndex = snapshot.PublishIndex - 1;
+		return;
 	}
+
+	// Nothing was published since the poses were last applied
+	if (snapshot.PublishIndex == LastAppliedPublishIndex)
+		return;
+
+	// Get positional data from global coordinates (xpos, xquat, geom_xpos and geom_xmat)
+	Poses.SetBodies(snapshot.BodyXPos.GetData(), snapshot.BodyXQuat.GetData());
+	Poses.SetGeoms(snapshot.GeomXPos.GetData(), snapshot.GeomXMat.GetData());
+
+	// The worker recorded which bodies moved; only those and their geoms need new transforms
+	if (LastAppliedPublishIndex == MAX_uint64)
+		Poses.MarkAllDirty();
+	else
+		Poses.MarkMoved(snapshot.BodyChangeIndex.GetData(), LastAppliedPublishIndex, mModel->geom_bodyid);
+	LastAppliedPublishIndex = snapshot.PublishIndex;
 }
 
 AMuJoCoSimulation::AMuJoCoSimulation()
@@ -250,19 +461,65 @@ void AMuJoCoSimulation::BeginPlay()
 	if (mModel)
 	{
 		_info = ExtractModelInfo(mModel);
-		ConvertMuJoCoModelToProceduralMeshes(mModel, this);
-		GenerateMeshes(_info);
+		PoseBuffer.Initialize(mModel->nbody, mModel->ngeom);
+		MeshCache.Init(nullptr, mModel->nmesh);
+		MeshMemoryBaseline = FPlatformMemory::GetStats().UsedPhysical;
+		if (bAsyncMeshConversion && mModel->nmesh > 0)
+			StartMeshConversion(); // components are generated by PollMeshConversion
+		else
+		{
+			ConvertModelMeshes();
+			FinishModelMeshes();
+		}
+	}
+	WorkerThread = nullptr;
+	WorkerRunnable = nullptr;
+	if (!mModel || !mData)
+		return;
+	SnapshotBuffer.Initialize(mModel, mData, bInterpolatePoses, RestThreshold);
+	LastAppliedPublishIndex = MAX_uint64;
+
+	if (bUseThreadPool)
+	{
+		ThreadPool = mju_threadPoolCreate(GetThreadPoolWorkerCount());
+		mju_bindThreadPool(mData, ThreadPool);
 	}
+
 	// Initialize worker thread
+	FMujocoWorkerSettings settings;
+	settings.PacingMode = PacingMode;
+	settings.RealTimeFactor = RealTimeFactor;
+	settings.MaxStepsPerWake = MaxStepsPerWake;
+	settings.LagPolicy = LagPolicy;
+	settings.MinSolverIterations = MinSolverIterations;
+	PendingControls.SetNumZeroed(mModel->nu);
+	bControlsDirty = false;
+	LockstepRemainder = 0.0;
+	bSimulationRunning = true;
 	bStopThread = false;
-    WorkerRunnable = new FMujocoWorkerThread(*mData, *mModel, bStopThread, ThreadRunCount); 
-    WorkerThread = FRunnableThread::Create(WorkerRunnable, TEXT("MujocoWorkerThread"));
+    WorkerRunnable = new FMujocoWorkerThread(*mData, *mModel, bStopThread, ThreadRunCount, SnapshotBuffer, CommandQueue, settings); 
+
+	UMujocoSimulationSubsystem *scheduler = GetWorld()->GetSubsystem<UMujocoSimulationSubsystem>();
+	if (StepMode == EMujocoStepMode::Pipelined || StepMode == EMujocoStepMode::Lockstep)
+		return; // stepped from Tick
+	if (StepMode == EMujocoStepMode::SharedScheduler && scheduler)
+		scheduler->RegisterSimulation(WorkerRunnable);
+	else
+		WorkerThread = FRunnableThread::Create(WorkerRunnable, TEXT("MujocoWorkerThread"));
 }
 
 void AMuJoCoSimulation::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
     // 停止并销毁线程
 	bStopThread = true;
+	PipelineTask.Wait();
+	MeshConversionTask.Wait();
+	MeshConversionTask = UE::Tasks::FTask();
+	if (WorkerRunnable && !WorkerThread && StepMode == EMujocoStepMode::SharedScheduler)
+	{
+		if (UMujocoSimulationSubsystem *scheduler = GetWorld()->GetSubsystem<UMujocoSimulationSubsystem>())
+			scheduler->UnregisterSimulation(WorkerRunnable);
+	}
     if (WorkerThread)
     {
         WorkerThread->Kill(true);
@@ -283,53 +540,251 @@ void AMuJoCoSimulation::EndPlay(const EEndPlayReason::Type EndPlayReason)
 		mj_deleteModel(mModel);
 	mData = nullptr;
 	mModel = nullptr;
+
+	// The pool must outlive every mjData bound to it
+	if (ThreadPool)
+		mju_threadPoolDestroy(ThreadPool);
+	ThreadPool = nullptr;
 	Super::EndPlay(EndPlayReason);
 }
 
-void AMuJoCoSimulation::UpdateSimulationView(const ModelInfo &Info)
+void AMuJoCoSimulation::UpdateSimulationView(FMujocoPoseBuffer &Poses)
 {
-	FVector BaseLocation = BodyMap[0]->GetComponentLocation();
-	FQuat BaseRotation = BodyMap[0]->GetComponentRotation().Quaternion(); // GetActorRotation().Quaternion();
+	// Poses are relative to the actor; if it moved, everything has to be placed again
+	const FTransform &root = GetRootComponent()->GetComponentTransform();
+	if (!root.Equals(LastRootTransform, 0))
+	{
+		Poses.MarkAllDirty();
+		LastRootTransform = root;
+	}
 
-	int BodyId = 0;
-	for (const BodyInfo &bodyInfo : Info.bodies)
+	// The single proxy gets every moved geom: one off screen may still cast a visible shadow
+	if (bCullUpdates && GeomRenderMode != EMujocoGeomRenderMode::SingleProxy && (bBatchTransformUpdates || GeomRenderMode == EMujocoGeomRenderMode::InstancedMeshes))
 	{
+		// Out of view: keep every flag for when the model comes back into view
+		if (!ComputeVisibility(Poses))
+		{
+			DirtyFraction = 0;
+			return;
+		}
+		Poses.DeferGeoms(GeomVisible.GetData());
+	}
 
-		USceneComponent *sceneComponent = BodyMap[BodyId];
-		if (!sceneComponent)
+	if (bBatchTransformUpdates)
+	{
+		ComputeWorldTransforms(Poses);
+		CommitWorldTransforms(Poses);
+	}
+	else
+		UpdateComponentsPerCall(Poses);
+
+	if (GeomRenderMode == EMujocoGeomRenderMode::InstancedMeshes)
+		UpdateInstancedGeoms(Poses);
+	else if (GeomRenderMode == EMujocoGeomRenderMode::SingleProxy && ModelComponent)
+		ModelComponent->UpdatePoses(Poses);
+
+	DirtyFraction = Poses.GetDirtyFraction();
+	Poses.ClearDirty();
+}
+
+bool AMuJoCoSimulation::IsGeomGroupVisible(int GeomId) const
+{
+	const int group = mModel->geom_group[GeomId];
+	return group < 0 || group >= 32 || (VisibleGeomGroups & (1 << group)) != 0;
+}
+
+bool AMuJoCoSimulation::ComputeVisibility(const FMujocoPoseBuffer &Poses)
+{
+	GeomVisible.Init(1, Poses.NumGeoms());
+
+	const APlayerController *controller = GetWorld() ? GetWorld()->GetFirstPlayerController() : nullptr;
+	if (!controller || !controller->PlayerCameraManager)
+		return true;
+	const FMinimalViewInfo view = controller->PlayerCameraManager->GetCameraCacheView();
+	FMatrix viewMatrix, projectionMatrix, viewProjectionMatrix;
+	UGameplayStatics::GetViewProjectionMatrix(view, viewMatrix, projectionMatrix, viewProjectionMatrix);
+	FConvexVolume frustum;
+	GetViewFrustumBounds(frustum, viewProjectionMatrix, false);
+	const double maxDistance = CullDistance > 0 ? CullDistance : TNumericLimits<double>::Max();
+
+	const FTransform &root = GetRootComponent()->GetComponentTransform();
+	const FVector BaseLocation = root.GetLocation();
+	const FQuat BaseRotation = root.GetRotation();
+	auto isVisible = [&frustum, &view, maxDistance](const FVector &Center, double Radius)
+	{
+		return frustum.IntersectSphere(Center, Radius) && FVector::Dist(Center, view.Location) - Radius <= maxDistance;
+	};
+
+	// Whole model first: a sphere around all moving bodies grown by the largest geom.
+	// The world body (0) and its geoms never move, so they do not count.
+	FBox bodies(ForceInit);
+	for (int32 i = 1; i < Poses.NumBodies(); ++i)
+		bodies += Poses.BodyPositions[i];
+	double maxRadius = 0;
+	for (int i = 0; i < mModel->ngeom; ++i)
+		maxRadius = FMath::Max(maxRadius, mModel->geom_rbound[i] * 100);
+	if (bodies.IsValid && !isVisible(CalculateWorldPosition(BaseLocation, BaseRotation, bodies.GetCenter()), bodies.GetExtent().Size() + maxRadius))
+		return false;
+
+	MujocoPoseConversion::ForEachChunk(Poses.NumGeoms(), [this, &Poses, &isVisible, &BaseLocation, &BaseRotation](int32 Start, int32 Num)
+	{
+		for (int GeomId = Start; GeomId < Start + Num; ++GeomId)
+		{
+			// Planes and other infinite geoms have no bounding radius and are always kept
+			const double radius = mModel->geom_rbound[GeomId] * 100;
+			if (radius > 0)
+				GeomVisible[GeomId] = isVisible(CalculateWorldPosition(BaseLocation, BaseRotation, Poses.GeomPositions[GeomId]), radius);
+		}
+	});
+	return true;
+}
+
+void AMuJoCoSimulation::UpdateInstancedGeoms(const FMujocoPoseBuffer &Poses)
+{
+	const FTransform &root = GetRootComponent()->GetComponentTransform();
+	const FVector BaseLocation = root.GetLocation();
+	const FQuat BaseRotation = root.GetRotation();
+
+	// Gather every moved instance (in parallel for large models), then commit each touched group in one batched call
+	MujocoPoseConversion::ForEachChunk(GeomInstances.Num(), [this, &Poses, &BaseLocation, &BaseRotation](int32 Start, int32 Num)
+	{
+		for (int GeomId = Start; GeomId < Start + Num; ++GeomId)
+		{
+			const FIntPoint instance = GeomInstances[GeomId];
+			if (instance.X == INDEX_NONE || !Poses.GeomDirty[GeomId])
+				continue;
+			FTransform &transform = InstancedGroupTransforms[instance.X][instance.Y];
+			transform.SetLocation(CalculateWorldPosition(BaseLocation, BaseRotation, Poses.GeomPositions[GeomId]));
+			transform.SetRotation(Poses.GeomRotations[GeomId]);
+		}
+	});
+	InstancedGroupDirty.SetNum(InstancedGeomGroups.Num());
+	for (int32 group = 0; group < InstancedGeomGroups.Num(); ++group)
+		InstancedGroupDirty[group].Init(false, InstancedGroupTransforms[group].Num());
+	for (int GeomId = 0; GeomId < GeomInstances.Num(); ++GeomId)
+	{
+		const FIntPoint instance = GeomInstances[GeomId];
+		if (instance.X != INDEX_NONE && Poses.GeomDirty[GeomId])
+			InstancedGroupDirty[instance.X][instance.Y] = true;
+	}
+
+	// One call per touched group, covering the instances from the first moved one to the last
+	for (int32 group = 0; group < InstancedGeomGroups.Num(); ++group)
+	{
+		const TBitArray<> &dirty = InstancedGroupDirty[group];
+		const int32 first = dirty.Find(true);
+		if (first == INDEX_NONE)
 			continue;
-		FVector WorldLoc = CalculateWorldPosition(BaseLocation, BaseRotation, FVector(bodyInfo.pos[0] * 100, bodyInfo.pos[1] * 100, bodyInfo.pos[2] * 100));
-		sceneComponent->SetWorldLocation(WorldLoc);
-		FQuat worldRot = CalculateWorldRotation(BaseRotation, bodyInfo.quat2);
-		sceneComponent->SetWorldRotation(bodyInfo.quat2 /*worldRot*/);
+		const int32 last = dirty.FindLast(true);
+		const TArray<FTransform> &transforms = InstancedGroupTransforms[group];
+		if (first == 0 && last == transforms.Num() - 1)
+		{
+			InstancedGeomGroups[group]->BatchUpdateInstancesTransforms(0, transforms, true, true, true);
+		}
+		else
+		{
+			InstancedRunTransforms.Reset();
+			InstancedRunTransforms.Append(transforms.GetData() + first, last - first + 1);
+			InstancedGeomGroups[group]->BatchUpdateInstancesTransforms(first, InstancedRunTransforms, true, true, true);
+		}
+	}
+}
+
+void AMuJoCoSimulation::ComputeWorldTransforms(const FMujocoPoseBuffer &Poses)
+{
+	// Body 0 is the world body, which sits on the actor root
+	const FTransform &root = GetRootComponent()->GetComponentTransform();
+	const FVector BaseLocation = root.GetLocation();
+	const FQuat BaseRotation = root.GetRotation();
+
+	// Flat layout without body components has nothing to place per body
+	BodyWorldTransforms.SetNum(BodyMap.Num() ? FMath::Min(Poses.NumBodies(), BodyComponents.Num()) : 0);
+	MujocoPoseConversion::ForEachChunk(BodyWorldTransforms.Num(), [this, &Poses, &BaseLocation, &BaseRotation](int32 Start, int32 Num)
+	{
+		for (int BodyId = Start; BodyId < Start + Num; ++BodyId)
+		{
+			if (!Poses.BodyDirty[BodyId])
+				continue;
+			FTransform &transform = BodyWorldTransforms[BodyId];
+			transform.SetLocation(CalculateWorldPosition(BaseLocation, BaseRotation, Poses.BodyPositions[BodyId]));
+			transform.SetRotation(Poses.BodyRotations[BodyId]);
+		}
+	});
 
-		//	sceneComponent->SetRelativeLocation(FVector(bodyInfo.pos[0]*100, bodyInfo.pos[1]*100, bodyInfo.pos[2]*100));
-		//		sceneComponent->SetRelativeRotation(bodyInfo.quat2);
+	// Instanced and single proxy modes have no geom components to place
+	GeomWorldTransforms.SetNum(GeomMap1.Num() ? Poses.NumGeoms() : 0);
+	MujocoPoseConversion::ForEachChunk(GeomWorldTransforms.Num(), [this, &Poses, &BaseLocation, &BaseRotation](int32 Start, int32 Num)
+	{
+		for (int GeomId = Start; GeomId < Start + Num; ++GeomId)
+		{
+			if (!Poses.GeomDirty[GeomId])
+				continue;
+			FTransform &transform = GeomWorldTransforms[GeomId];
+			transform.SetLocation(CalculateWorldPosition(BaseLocation, BaseRotation, Poses.GeomPositions[GeomId]));
+			transform.SetRotation(Poses.GeomRotations[GeomId]);
+		}
+	});
+}
 
-		//	UE_LOG(LogTemp, Warning, TEXT("Body %d [%hs][%f]: %f %f %f"), BodyId,bodyInfo.name.c_str(), mData->time,bodyInfo.pos[0], bodyInfo.pos[1], bodyInfo.pos[2]);
-		//	UE_LOG(LogTemp, Warning, TEXT("Body %d [%hs][%f]: %f %f %f %f"), BodyId,bodyInfo.name.c_str(), mData->time,bodyInfo.quat[1], bodyInfo.quat[2], bodyInfo.quat[3], bodyInfo.quat[0]);
-		BodyId++;
+static void ApplyWorldTransform(USceneComponent *Component, const FTransform &Transform)
+{
+	if (Component->IsUsingAbsoluteLocation() && Component->IsUsingAbsoluteRotation())
+	{
+		// Relative == world here: write it directly and update once, skipping MoveComponent and physics
+		Component->SetRelativeLocation_Direct(Transform.GetLocation());
+		Component->SetRelativeRotation_Direct(Transform.Rotator());
+		Component->UpdateComponentToWorld(EUpdateTransformFlags::SkipPhysicsUpdate, ETeleportType::TeleportPhysics);
 	}
+	else
+		Component->SetWorldLocationAndRotation(Transform.GetLocation(), Transform.GetRotation(), false, nullptr, ETeleportType::TeleportPhysics);
+}
 
-	int GeomId = 0;
-	for (const GeomInfo &geomInfo : Info.geoms)
+void AMuJoCoSimulation::CommitWorldTransforms(const FMujocoPoseBuffer &Poses)
+{
+	for (int BodyId = 1; BodyId < BodyWorldTransforms.Num(); ++BodyId)
+	{
+		if (!Poses.BodyDirty[BodyId])
+			continue;
+		if (USceneComponent *sceneComponent = BodyComponents[BodyId])
+			ApplyWorldTransform(sceneComponent, BodyWorldTransforms[BodyId]);
+	}
+	const int32 numGeoms = FMath::Min(GeomWorldTransforms.Num(), GeomComponents.Num());
+	for (int GeomId = 0; GeomId < numGeoms; ++GeomId)
 	{
+		if (!Poses.GeomDirty[GeomId])
+			continue;
+		if (UStaticMeshComponent *staticMeshComponent = GeomComponents[GeomId])
+			ApplyWorldTransform(staticMeshComponent, GeomWorldTransforms[GeomId]);
+	}
+}
 
-		UStaticMeshComponent *staticMeshComponent = GeomMap1[GeomId];
+void AMuJoCoSimulation::UpdateComponentsPerCall(const FMujocoPoseBuffer &Poses)
+{
+	USceneComponent *baseComponent = GetBodyComponent(0) ? GetBodyComponent(0) : GetRootComponent();
+	FVector BaseLocation = baseComponent->GetComponentLocation();
+	FQuat BaseRotation = baseComponent->GetComponentRotation().Quaternion(); // GetActorRotation().Quaternion();
+
+	for (int BodyId = 0; BodyId < Poses.NumBodies(); ++BodyId)
+	{
+		USceneComponent *sceneComponent = GetBodyComponent(BodyId);
+		if (!sceneComponent)
+			break;
+		FVector WorldLoc = CalculateWorldPosition(BaseLocation, BaseRotation, Poses.BodyPositions[BodyId]);
+		sceneComponent->SetWorldLocation(WorldLoc);
+		sceneComponent->SetWorldRotation(Poses.BodyRotations[BodyId]);
+	}
+
+	for (int GeomId = 0; GeomId < Poses.NumGeoms(); ++GeomId)
+	{
+		UStaticMeshComponent *staticMeshComponent = GetGeomComponent(GeomId);
 		if (!staticMeshComponent)
 			continue;
 
-		//	staticMeshComponent->SetRelativeLocation(FVector(geomInfo.pos[0]*100, geomInfo.pos[1]*100, geomInfo.pos[2]*100));
-		//	staticMeshComponent->SetRelativeRotation(geomInfo.quat2);
-
-		FVector WorldLoc = CalculateWorldPosition(BaseLocation, BaseRotation, FVector(geomInfo.pos[0] * 100, geomInfo.pos[1] * 100, geomInfo.pos[2] * 100));
+		FVector WorldLoc = CalculateWorldPosition(BaseLocation, BaseRotation, Poses.GeomPositions[GeomId]);
 		staticMeshComponent->SetWorldLocation(WorldLoc);
-		FQuat worldRot = CalculateWorldRotation(BaseRotation, geomInfo.quat2);
-		//	staticMeshComponent->SetWorldRotation(geomInfo.quat2/*worldRot*/);
-
-		// UE_LOG(LogTemp, Warning, TEXT("Geom %d[%hs][%f]: %f %f %f"), GeomId,geomInfo.name.c_str() ,mData->time,geomInfo.pos[0], geomInfo.pos[1], geomInfo.pos[2]);
-		// UE_LOG(LogTemp, Warning, TEXT("Geom %d[%hs][%f]: %f %f %f %f"), GeomId,geomInfo.name.c_str() ,mData->time,geomInfo.quat[1], geomInfo.quat[2], geomInfo.quat[3], geomInfo.quat[0]);
-		GeomId++;
+		// Without a parent body the geom does not inherit its orientation
+		if (bFlatComponentLayout)
+			staticMeshComponent->SetWorldRotation(Poses.GeomRotations[GeomId]);
 	}
 }
 
@@ -340,16 +795,29 @@ void AMuJoCoSimulation::SimulateMuJoCo(float DeltaTime)
 		UE_LOG(LogTemp, Error, TEXT("Model or data is null"));
 		return;
 	}
-	// double startTime = mData->time;
-	// while (mData->time - startTime < DeltaTime)
-	// 	mj_step(mModel, mData);
+	if (StepMode == EMujocoStepMode::Lockstep && WorkerRunnable)
+	{
+		// Whole steps only; the leftover fraction is carried over so the simulated time tracks the frame time
+		const double timestep = mModel->opt.timestep;
+		LockstepRemainder += bOverrideDeltaTime ? FixedDeltaTime : DeltaTime;
+		// The tolerance keeps a float FixedDeltaTime that is a multiple of the timestep from coming up one step short
+		int32 substeps = FMath::FloorToInt(LockstepRemainder / timestep + KINDA_SMALL_NUMBER);
+		LockstepRemainder -= substeps * timestep;
+		if (MaxSubstepsPerTick > 0 && substeps > MaxSubstepsPerTick)
+		{
+			// Drop what the cap cuts off rather than owing it to later frames
+			substeps = MaxSubstepsPerTick;
+			LockstepRemainder = 0.0;
+		}
+		WorkerRunnable->StepFixed(substeps);
+	}
 
-	ModelInfo info;
-	if (!_info.bodies.size())
+	// Nothing to show until the components exist
+	if (!PoseBuffer.NumBodies() || MeshConversionTask.IsValid())
 		return;
-	ExtractCurrentState(_info);
+	ExtractCurrentState(PoseBuffer);
 
-	UpdateSimulationView(_info);
+	UpdateSimulationView(PoseBuffer);
 }
 
 bool AMuJoCoSimulation::LoadModel(FString Xml)
@@ -379,43 +847,284 @@ bool AMuJoCoSimulation::LoadModel(FString Xml)
 void AMuJoCoSimulation::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+	if (MeshConversionTask.IsValid())
+		PollMeshConversion();
+	if (StepMode == EMujocoStepMode::Pipelined)
+	{
+		TickPipelined();
+		return;
+	}
+	FlushControls();
 	// if (bSimulationRunning)
 	SimulateMuJoCo(DeltaTime);
 }
 
+int32 AMuJoCoSimulation::GetStepsPerFixedFrame() const
+{
+	return FMath::Max(1, FMath::RoundToInt(FixedDeltaTime / mModel->opt.timestep));
+}
+
+void AMuJoCoSimulation::TickPipelined()
+{
+	if (!WorkerRunnable)
+		return;
+
+	// Frame N was simulated while the previous frame rendered; wait for it and show it
+	PipelineTask.Wait();
+	FlushControls();
+	SimulateMuJoCo(FixedDeltaTime);
+
+	// Simulate frame N+1 while this frame renders. Commands queued so far apply at its start.
+	FMujocoWorkerThread *stepper = WorkerRunnable;
+	const int32 steps = GetStepsPerFixedFrame();
+	PipelineTask = UE::Tasks::Launch(TEXT("MujocoPipelinedStep"), [stepper, steps]()
+	{
+		stepper->StepFixed(steps);
+	});
+}
+
+bool AMuJoCoSimulation::SendCommand(FMujocoCommand &&Command)
+{
+	if (!WorkerRunnable)
+		return false;
+	// Controls set earlier this frame must reach the worker before anything queued after them
+	if (Command.Type != EMujocoCommandType::SetControls)
+		FlushControls();
+	if (!CommandQueue.Enqueue(MoveTemp(Command)))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("MuJoCo command queue is full, command dropped"));
+		return false;
+	}
+	return true;
+}
+
+void AMuJoCoSimulation::FlushControls()
+{
+	if (!bControlsDirty)
+		return;
+	FMujocoCommand command(EMujocoCommandType::SetControls);
+	command.Data = PendingControls;
+	// Keep the controls dirty if the queue is full so they are sent again next Tick
+	if (SendCommand(MoveTemp(command)))
+		bControlsDirty = false;
+}
+
 void AMuJoCoSimulation::SetControl(int Id, float Value)
 {
-	if (!mData || !mModel || mModel->nu <= Id)
+	// PendingControls is only sized once the worker exists, which also needs a valid mjData
+	if (!WorkerRunnable || !PendingControls.IsValidIndex(Id))
 		return;
-	mData->ctrl[Id] = Value;
+	PendingControls[Id] = Value;
+	bControlsDirty = true;
 }
+
+void AMuJoCoSimulation::SetControls(const TArray<float> &Values)
+{
+	if (!WorkerRunnable || Values.Num() != PendingControls.Num())
+		return;
+	for (int i = 0; i < Values.Num(); ++i)
+		PendingControls[i] = Values[i];
+	bControlsDirty = true;
+}
+
+void AMuJoCoSimulation::LoadKeyframe(int32 Key)
+{
+	if (!mModel || Key < 0 || Key >= mModel->nkey)
+		return;
+	FMujocoCommand command(EMujocoCommandType::LoadKeyframe);
+	command.Index = Key;
+	if (SendCommand(MoveTemp(command)))
+	{
+		// The keyframe replaces ctrl on the worker; keep the pending vector in sync
+		if (mModel->nu > 0)
+			FMemory::Memcpy(PendingControls.GetData(), mModel->key_ctrl + Key * mModel->nu, mModel->nu * sizeof(mjtNum));
+		bControlsDirty = false;
+	}
+}
+
+void AMuJoCoSimulation::SetState(const TArray<float> &QPos, const TArray<float> &QVel)
+{
+	if (!mModel || QPos.Num() != mModel->nq || QVel.Num() != mModel->nv)
+		return;
+	FMujocoCommand command(EMujocoCommandType::SetState);
+	command.Data.Append(QPos);
+	command.Data2.Append(QVel);
+	SendCommand(MoveTemp(command));
+}
+
+void AMuJoCoSimulation::SetPacingMode(EMujocoPacingMode Mode)
+{
+	PacingMode = Mode;
+	if (WorkerRunnable)
+		WorkerRunnable->SetPacingMode(Mode);
+}
+
+void AMuJoCoSimulation::SetRealTimeFactor(float Factor)
+{
+	RealTimeFactor = FMath::Max(Factor, 0.0f);
+	if (WorkerRunnable)
+		WorkerRunnable->SetRealTimeFactor(RealTimeFactor);
+}
+
+FMujocoLagStats AMuJoCoSimulation::GetLagStats() const
+{
+	return WorkerRunnable ? WorkerRunnable->GetLagStats() : FMujocoLagStats();
+}
+
+int32 AMuJoCoSimulation::GetThreadPoolWorkerCount() const
+{
+	const int32 workers = ThreadPoolWorkers > 0 ? ThreadPoolWorkers : FPlatformMisc::NumberOfCoresIncludingHyperthreads() - 1;
+	return FMath::Clamp(workers, 1, mjMAXTHREAD);
+}
+
+float AMuJoCoSimulation::BenchmarkThreadPool(int32 Steps)
+{
+	if (!mModel || Steps <= 0)
+		return 0;
+
+	auto timeSteps = [this, Steps](mjThreadPool *pool)
+	{
+		mjData *scratch = mj_makeData(mModel);
+		if (pool)
+			mju_bindThreadPool(scratch, pool);
+		const double start = FPlatformTime::Seconds();
+		for (int32 i = 0; i < Steps; ++i)
+			mj_step(mModel, scratch);
+		const double elapsed = FPlatformTime::Seconds() - start;
+		mj_deleteData(scratch);
+		return elapsed;
+	};
+
+	const int32 workers = GetThreadPoolWorkerCount();
+	mjThreadPool *pool = mju_threadPoolCreate(workers);
+	const double singleTime = timeSteps(nullptr);
+	const double pooledTime = timeSteps(pool);
+	mju_threadPoolDestroy(pool);
+
+	const float speedUp = pooledTime > 0 ? (float)(singleTime / pooledTime) : 0;
+	UE_LOG(LogTemp, Log, TEXT("MuJoCo %s: %d steps single-threaded %.3f ms/step, %d pool threads %.3f ms/step, speed-up %.2fx"),
+		   *XmlSourcePath, Steps, singleTime * 1000 / Steps, workers, pooledTime * 1000 / Steps, speedUp);
+	return speedUp;
+}
+
+float AMuJoCoSimulation::BenchmarkTransformUpdate(int32 Iterations)
+{
+	if (Iterations <= 0 || BodyMap.Num() + GeomMap1.Num() == 0 || !PoseBuffer.NumBodies())
+		return 0;
+
+	const double perCallStart = FPlatformTime::Seconds();
+	for (int32 i = 0; i < Iterations; ++i)
+		UpdateComponentsPerCall(PoseBuffer);
+	const double perCallTime = FPlatformTime::Seconds() - perCallStart;
+
+	// Run the batched path last so the components end up with its (complete) transforms.
+	// Everything is marked dirty so each iteration is a full update.
+	const double batchedStart = FPlatformTime::Seconds();
+	for (int32 i = 0; i < Iterations; ++i)
+	{
+		PoseBuffer.MarkAllDirty();
+		ComputeWorldTransforms(PoseBuffer);
+		CommitWorldTransforms(PoseBuffer);
+	}
+	const double batchedTime = FPlatformTime::Seconds() - batchedStart;
+	PoseBuffer.ClearDirty();
+
+	const float speedUp = batchedTime > 0 ? (float)(perCallTime / batchedTime) : 0;
+	UE_LOG(LogTemp, Log, TEXT("MuJoCo %s: %d bodies, %d geoms, per-component update %.3f ms, batched update %.3f ms, speed-up %.2fx"),
+		   *XmlSourcePath, BodyMap.Num(), GeomMap1.Num(), perCallTime * 1000 / Iterations, batchedTime * 1000 / Iterations, speedUp);
+	return speedUp;
+}
+
+float AMuJoCoSimulation::BenchmarkPoseConversion(int32 Iterations)
+{
+	const FMujocoStateSnapshot &snapshot = SnapshotBuffer.AcquireLatest();
+	const int32 count = snapshot.GeomXMat.Num() / 9;
+	if (Iterations <= 0 || count == 0)
+		return 0;
+	const mjtNum *mats = snapshot.GeomXMat.GetData();
+
+	TArray<FQuat> reference, scalar, batched;
+	reference.SetNumUninitialized(count);
+	scalar.SetNumUninitialized(count);
+	batched.SetNumUninitialized(count);
+
+	// The per-geom path ExtractCurrentState used before the batch kernel
+	const double referenceStart = FPlatformTime::Seconds();
+	for (int32 iteration = 0; iteration < Iterations; ++iteration)
+	{
+		for (int32 i = 0; i < count; ++i)
+		{
+			mjtNum quat[4];
+			mju_mat2Quat(quat, mats + 9 * i);
+			reference[i] = FQuat(quat[1], quat[2], quat[3], quat[0]);
+		}
+	}
+	const double referenceTime = FPlatformTime::Seconds() - referenceStart;
+
+	const double scalarStart = FPlatformTime::Seconds();
+	for (int32 iteration = 0; iteration < Iterations; ++iteration)
+		MujocoPoseConversion::ConvertMatricesScalar(mats, scalar.GetData(), count);
+	const double scalarTime = FPlatformTime::Seconds() - scalarStart;
+
+	const double batchedStart = FPlatformTime::Seconds();
+	for (int32 iteration = 0; iteration < Iterations; ++iteration)
+		MujocoPoseConversion::ConvertMatrices(mats, batched.GetData(), count);
+	const double batchedTime = FPlatformTime::Seconds() - batchedStart;
+
+	// q and -q are the same rotation, so compare the angle between them
+	double maxError = 0;
+	for (int32 i = 0; i < count; ++i)
+	{
+		maxError = FMath::Max(maxError, reference[i].AngularDistance(batched[i]));
+		maxError = FMath::Max(maxError, reference[i].AngularDistance(scalar[i]));
+	}
+
+	const float speedUp = batchedTime > 0 ? (float)(referenceTime / batchedTime) : 0;
+	UE_LOG(LogTemp, Log, TEXT("MuJoCo %s: %d matrices, mju_mat2Quat %.3f us, scalar kernel %.3f us, batch kernel %.3f us, speed-up %.2fx, max error %g rad"),
+		   *XmlSourcePath, count, referenceTime * 1e6 / Iterations, scalarTime * 1e6 / Iterations, batchedTime * 1e6 / Iterations, speedUp, maxError);
+	return speedUp;
+}
+
+FMujocoSchedulerStats AMuJoCoSimulation::GetSchedulerStats() const
+{
+	FMujocoSchedulerStats stats;
+	const UMujocoSimulationSubsystem *scheduler = GetWorld() ? GetWorld()->GetSubsystem<UMujocoSimulationSubsystem>() : nullptr;
+	if (scheduler && WorkerRunnable && !WorkerThread)
+		scheduler->GetSimulationStats(WorkerRunnable, stats);
+	return stats;
+}
+
 void AMuJoCoSimulation::StartSimulation()
 {
-	bSimulationRunning = true;
+	FMujocoCommand command(EMujocoCommandType::SetPaused);
+	command.bFlag = false;
+	if (SendCommand(MoveTemp(command)))
+		bSimulationRunning = true;
 }
 
 void AMuJoCoSimulation::PauseSimulation()
 {
-	bSimulationRunning = false;
+	FMujocoCommand command(EMujocoCommandType::SetPaused);
+	command.bFlag = true;
+	if (SendCommand(MoveTemp(command)))
+		bSimulationRunning = false;
 }
 
 void AMuJoCoSimulation::ResetSimulation()
 {
-	bSimulationRunning = false;
-	if (mData)
-		mj_deleteData(mData);
-	mData = mj_makeData(mModel);
-	ExtractCurrentState(_info);
-	UpdateSimulationView(_info);
+	// mjData is owned by the worker; it resets it between two steps and publishes the new state
+	if (!SendCommand(FMujocoCommand(EMujocoCommandType::Reset)))
+		return;
+	FMemory::Memzero(PendingControls.GetData(), PendingControls.Num() * sizeof(mjtNum));
+	bControlsDirty = false;
+	LockstepRemainder = 0.0;
+	PauseSimulation();
 }
 
 void AMuJoCoSimulation::StepSimulation()
 {
 	LogInfo();
-	mj_step(mModel, mData);
-	ExtractCurrentState(_info);
-	UpdateSimulationView(_info);
-	LogInfo();
+	SendCommand(FMujocoCommand(EMujocoCommandType::Step));
 }
 
 void AMuJoCoSimulation::LogInfo()
@@ -424,7 +1133,7 @@ void AMuJoCoSimulation::LogInfo()
 	int BodyId = 0;
 	for (const auto &bodyInfo : _info.bodies)
 	{
-		if (USceneComponent *bodyComponent = BodyMap[BodyId])
+		if (USceneComponent *bodyComponent = GetBodyComponent(BodyId))
 		{
 			FVector worldLoc = bodyComponent->GetComponentLocation();
 			FRotator worldRot = bodyComponent->GetComponentRotation();
@@ -441,7 +1150,7 @@ void AMuJoCoSimulation::LogInfo()
 	int GeomId = 0;
 	for (const auto &geomInfo : _info.geoms)
 	{
-		if (UStaticMeshComponent *geomComponent = GeomMap1[GeomId])
+		if (UStaticMeshComponent *geomComponent = GetGeomComponent(GeomId))
 		{
 			FVector worldLoc = geomComponent->GetComponentLocation();
 			FRotator worldRot = geomComponent->GetComponentRotation();
@@ -464,75 +1173,36 @@ void AMuJoCoSimulation::ConvertMuJoCoModelToProceduralMeshes(const mjModel *mjMo
 		return;
 	}
 
-	// Iterate through all meshes in the MuJoCo model
-	for (int mesh_id = 0; mesh_id < mjModel->nmesh; mesh_id++)
-	{
-		// Extract mesh data from MuJoCo
-		const int vert_start = mjModel->mesh_vertadr[mesh_id];
-		const int nvert = mjModel->mesh_vertnum[mesh_id];
-		const float *mj_vertices = &mjModel->mesh_vert[vert_start * 3];
-
-		const int face_start = mjModel->mesh_faceadr[mesh_id];
-		const int nface = mjModel->mesh_facenum[mesh_id];
-		const int *mj_faces = &mjModel->mesh_face[face_start * 3];
-
-		// Skip empty meshes
-		if (nvert == 0 || nface == 0)
-			continue;
-
-		// Convert vertices to Unreal coordinates
-		TArray<FVector> UnrealVertices;
-		for (int i = 0; i < nvert; i++)
-		{
-			const float *v = &mj_vertices[i * 3];
-			UnrealVertices.Add(FVector(
-				v[0] * 100.0f,	// X: meters to cm
-				-v[1] * 100.0f, // Y: flip axis for left-handed
-				v[2] * 100.0f	// Z: meters to cm
-				));
-		}
+	MujocoMeshConversion::ConvertMeshes(mjModel, ConvertedMeshes, [](int32) {});
+	CreateProceduralMeshes(Outer);
+	OnMeshConversionProgress.Broadcast(mjModel->nmesh, mjModel->nmesh);
+}
 
-		// Convert faces to Unreal winding order (CW instead of MuJoCo's CCW)
-		TArray<int32> UnrealTriangles;
-		for (int i = 0; i < nface; i++)
+void AMuJoCoSimulation::CreateProceduralMeshes(UObject *Outer)
+{
+	ProceduralMeshes.Empty(ConvertedMeshes.Num());
+	for (FMujocoConvertedMesh &converted : ConvertedMeshes)
+	{
+		// Keep the array indexed by mesh id
+		if (converted.IsEmpty())
 		{
-			UnrealTriangles.Add(mj_faces[i * 3 + 0]);
-			UnrealTriangles.Add(mj_faces[i * 3 + 2]); // Swap order
-			UnrealTriangles.Add(mj_faces[i * 3 + 1]);
+			ProceduralMeshes.Add(nullptr);
+			continue;
 		}
 
 		// Create procedural mesh component
 		UProceduralMeshComponent *ProcMesh = NewObject<UProceduralMeshComponent>(Outer);
 		ProcMesh->RegisterComponent();
 
-		// Generate normals/tangents (using placeholder UVs if none exist)
-		TArray<FVector> Normals;
-		TArray<FVector2D> UVs;
-		TArray<FProcMeshTangent> Tangents;
-
-		// Generate default UVs if needed (flat projection)
-		UVs.SetNum(UnrealVertices.Num());
-		for (FVector2D &uv : UVs)
-		{
-			uv = FVector2D(0.5f, 0.5f); // Simple default
-		}
-
-		UKismetProceduralMeshLibrary::CalculateTangentsForMesh(
-			UnrealVertices,
-			UnrealTriangles,
-			UVs,
-			Normals,
-			Tangents);
-
 		// Create mesh section
 		ProcMesh->CreateMeshSection(
 			0,
-			UnrealVertices,
-			UnrealTriangles,
-			Normals,
-			UVs,
+			converted.Vertices,
+			converted.Triangles,
+			converted.Normals,
+			converted.UVs,
 			TArray<FColor>(), // Vertex colors
-			Tangents,
+			converted.Tangents,
 			true // Enable collision
 		);
 
@@ -543,8 +1213,92 @@ void AMuJoCoSimulation::ConvertMuJoCoModelToProceduralMeshes(const mjModel *mjMo
 		ProceduralMeshes.Add(ProcMesh);
 		ProcMesh->SetVisibility(false);
 	}
+	ConvertedMeshes.Empty();
+}
+
+void AMuJoCoSimulation::ConvertModelMeshes()
+{
+	if (!bBuildMeshesDirectly)
+	{
+		ConvertMuJoCoModelToProceduralMeshes(mModel, this);
+		return;
+	}
+	if (bUseMeshDiskCache)
+		MujocoMeshCache::BuildMeshDescriptions(mModel, MeshDescriptions, [](int32) {});
+	else
+		MujocoMeshConversion::BuildMeshDescriptions(mModel, MeshDescriptions, [](int32) {});
+	OnMeshConversionProgress.Broadcast(mModel->nmesh, mModel->nmesh);
+}
+
+void AMuJoCoSimulation::FinishModelMeshes()
+{
+	GenerateMeshes(_info);
+	MeshDescriptions.Empty();
+
+	// Procedural meshes are the only mesh data the actor keeps on the CPU after this
+	SIZE_T keptBytes = 0;
+	for (UProceduralMeshComponent *procMesh : ProceduralMeshes)
+	{
+		if (!procMesh)
+			continue;
+		for (int32 i = 0; i < procMesh->GetNumSections(); ++i)
+		{
+			const FProcMeshSection *section = procMesh->GetProcMeshSection(i);
+			keptBytes += section->ProcVertexBuffer.GetAllocatedSize() + section->ProcIndexBuffer.GetAllocatedSize();
+		}
+	}
+	int32 numBuilt = 0;
+	for (const UStaticMesh *mesh : MeshCache)
+		numBuilt += mesh != nullptr;
+	const FPlatformMemoryStats stats = FPlatformMemory::GetStats();
+	UE_LOG(LogTemp, Log, TEXT("MuJoCo meshes: %d of %d in use, %.2f MB kept in procedural meshes, process memory %+.1f MB since conversion start (peak %.1f MB)"),
+		   numBuilt, mModel->nmesh, keptBytes / (1024.0 * 1024.0),
+		   ((double)stats.UsedPhysical - (double)MeshMemoryBaseline) / (1024.0 * 1024.0), stats.PeakUsedPhysical / (1024.0 * 1024.0));
+}
+
+void AMuJoCoSimulation::StartMeshConversion()
+{
+	ConvertedMeshCount = 0;
+	ReportedMeshCount = 0;
+	// mjModel is never written after loading and EndPlay joins the task before freeing it
+	const mjModel *model = mModel;
+	const bool bDirect = bBuildMeshesDirectly;
+	const bool bDiskCache = bUseMeshDiskCache;
+	MeshConversionTask = UE::Tasks::Launch(TEXT("MujocoMeshConversion"), [this, model, bDirect, bDiskCache]()
+	{
+		auto onConverted = [this](int32)
+		{
+			ConvertedMeshCount.fetch_add(1, std::memory_order_relaxed);
+		};
+		if (bDirect && bDiskCache)
+			MujocoMeshCache::BuildMeshDescriptions(model, MeshDescriptions, onConverted);
+		else if (bDirect)
+			MujocoMeshConversion::BuildMeshDescriptions(model, MeshDescriptions, onConverted);
+		else
+			MujocoMeshConversion::ConvertMeshes(model, ConvertedMeshes, onConverted);
+	});
+}
+
+void AMuJoCoSimulation::PollMeshConversion()
+{
+	const int32 total = mModel->nmesh;
+	if (!MeshConversionTask.IsCompleted())
+	{
+		const int32 converted = ConvertedMeshCount.load(std::memory_order_relaxed);
+		if (converted != ReportedMeshCount)
+		{
+			ReportedMeshCount = converted;
+			OnMeshConversionProgress.Broadcast(converted, total);
+		}
+		return;
+	}
 
-	return;
+	MeshConversionTask = UE::Tasks::FTask();
+	if (!bBuildMeshesDirectly)
+		CreateProceduralMeshes(this);
+	FinishModelMeshes();
+	ReportedMeshCount = total;
+	OnMeshConversionProgress.Broadcast(total, total);
 }
 
 void AMuJoCoSimulation::SetMeshColor(UStaticMeshComponent *StaticMeshComponent, FLinearColor Color)
@@ -560,16 +1314,34 @@ void AMuJoCoSimulation::SetMeshColor(UStaticMeshComponent *StaticMeshComponent,
 
 	//	StaticMeshComponent->SetMaterial(0, Material);
 
-	// Create dynamic material instance
+	// One material for every geom; the color travels in the primitive's own data
+	if (PrimitiveColorMaterial)
+	{
+		StaticMeshComponent->SetMaterial(0, PrimitiveColorMaterial);
+		StaticMeshComponent->SetCustomPrimitiveDataVector4(0, FVector4(Color));
+		return;
+	}
+
 	UMaterialInterface *BaseMaterial = StaticMeshComponent->GetMaterial(0);
 	if (!BaseMaterial)
 		return;
 
-	UMaterialInstanceDynamic *DynamicMaterial = UMaterialInstanceDynamic::Create(BaseMaterial, StaticMeshComponent);
+	StaticMeshComponent->SetMaterial(0, GetColorMaterial(BaseMaterial, Color));
+}
+
+UMaterialInterface *AMuJoCoSimulation::GetColorMaterial(UMaterialInterface *BaseMaterial, const FLinearColor &Color)
+{
+	const TPair<UMaterialInterface *, FLinearColor> key(BaseMaterial, Color);
+	if (UMaterialInstanceDynamic **found = ColorMaterialLookup.Find(key))
+		return *found;
+
+	// Create dynamic material instance
+	UMaterialInstanceDynamic *DynamicMaterial = UMaterialInstanceDynamic::Create(BaseMaterial, this);
 	if (!DynamicMaterial)
-		return;
+		return BaseMaterial;
 
 	DynamicMaterial->SetVectorParameterValue(FName("BaseColor"), Color);
-
-	StaticMeshComponent->SetMaterial(0, DynamicMaterial);
+	ColorMaterials.Add(DynamicMaterial);
+	ColorMaterialLookup.Add(key, DynamicMaterial);
+	return DynamicMaterial;
 }
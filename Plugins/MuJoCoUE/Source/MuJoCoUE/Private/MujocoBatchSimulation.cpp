@@ -0,0 +1,134 @@
+#include "MujocoBatchSimulation.h"
+
+#include "Async/ParallelFor.h"
+#include "Misc/Paths.h"
+
+void UMujocoBatchSimulation::BeginDestroy()
+{
+	Release();
+	Super::BeginDestroy();
+}
+
+bool UMujocoBatchSimulation::Initialize(FString Xml, int32 NumInstances)
+{
+	Release();
+	if (NumInstances <= 0)
+		return false;
+
+	FString FullPath = FPaths::Combine(FPaths::ConvertRelativePathToFull(FPaths::ProjectContentDir()), Xml);
+	if (!FPaths::FileExists(FullPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("File does not exist: %s"), *FullPath);
+		return false;
+	}
+	char error[1000] = "";
+	Model = mj_loadXML(TCHAR_TO_ANSI(*FullPath), NULL, error, sizeof(error));
+	if (!Model)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to load model from %s: %hs"), *Xml, error);
+		return false;
+	}
+
+	Datas.Reserve(NumInstances);
+	for (int32 i = 0; i < NumInstances; ++i)
+	{
+		mjData *data = mj_makeData(Model);
+		if (!data)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Failed to make data for batch instance %d"), i);
+			Release();
+			return false;
+		}
+		mj_forward(Model, data);
+		Datas.Add(data);
+	}
+	return true;
+}
+
+void UMujocoBatchSimulation::Release()
+{
+	for (mjData *data : Datas)
+		mj_deleteData(data);
+	Datas.Empty();
+	if (Model)
+		mj_deleteModel(Model);
+	Model = nullptr;
+}
+
+void UMujocoBatchSimulation::StepAll(int32 NumSteps)
+{
+	if (!Model || NumSteps <= 0)
+		return;
+	// The model is only read by mj_step, so every instance can step on its own worker
+	ParallelFor(Datas.Num(), [this, NumSteps](int32 Index)
+	{
+		mjData *data = Datas[Index];
+		for (int32 step = 0; step < NumSteps; ++step)
+			mj_step(Model, data);
+	});
+}
+
+void UMujocoBatchSimulation::ResetInstances(const TArray<int32> &Instances, int32 Key)
+{
+	if (!Model)
+		return;
+	// Each instance once: two tasks resetting the same mjData would race
+	TBitArray<> listed(false, Datas.Num());
+	TArray<int32> unique;
+	unique.Reserve(Instances.Num());
+	for (const int32 instance : Instances)
+	{
+		if (!Datas.IsValidIndex(instance) || listed[instance])
+			continue;
+		listed[instance] = true;
+		unique.Add(instance);
+	}
+	ParallelFor(unique.Num(), [this, &unique, Key](int32 Index)
+	{
+		mjData *data = Datas[unique[Index]];
+		if (Key >= 0 && Key < Model->nkey)
+			mj_resetDataKeyframe(Model, data, Key);
+		else
+			mj_resetData(Model, data);
+		mj_forward(Model, data);
+	});
+}
+
+void UMujocoBatchSimulation::SetControls(const TArray<float> &Controls)
+{
+	if (!Model || Controls.Num() != Datas.Num() * Model->nu)
+		return;
+	const int32 nu = Model->nu;
+	for (int32 i = 0; i < Datas.Num(); ++i)
+	{
+		const float *source = Controls.GetData() + i * nu;
+		mjtNum *ctrl = Datas[i]->ctrl;
+		for (int32 j = 0; j < nu; ++j)
+			ctrl[j] = source[j];
+	}
+}
+
+int32 UMujocoBatchSimulation::GetObservationSize() const
+{
+	return Model ? Model->nq + Model->nv + Model->nsensordata : 0;
+}
+
+void UMujocoBatchSimulation::GetObservations(TArray<float> &OutObservations) const
+{
+	const int32 size = GetObservationSize();
+	OutObservations.SetNumUninitialized(Datas.Num() * size);
+	if (!Model)
+		return;
+
+	ParallelFor(Datas.Num(), [this, size, &OutObservations](int32 Index)
+	{
+		const mjData *data = Datas[Index];
+		float *out = OutObservations.GetData() + Index * size;
+		for (int32 i = 0; i < Model->nq; ++i)
+			*out++ = (float)data->qpos[i];
+		for (int32 i = 0; i < Model->nv; ++i)
+			*out++ = (float)data->qvel[i];
+		for (int32 i = 0; i < Model->nsensordata; ++i)
+			*out++ = (float)data->sensordata[i];
+	});
+}
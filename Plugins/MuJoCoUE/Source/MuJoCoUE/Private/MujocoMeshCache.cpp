@@ -0,0 +1,238 @@
+#include "MujocoMeshCache.h"
+
+#include "MujocoMeshConversion.h"
+
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Hash/xxhash.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Guid.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "StaticMeshAttributes.h"
+
+namespace
+{
+	constexpr uint32 CacheMagic = 0x434D4A4D; // "MJMC"
+	// Bump whenever the conversion or the file layout changes
+	constexpr uint32 CacheVersion = 1;
+
+	/** One triangle corner as stored in the file, in triangle order */
+	struct FCachedCorner
+	{
+		int32 Vertex;
+		FVector3f Normal;
+		FVector3f Tangent;
+		float BinormalSign;
+		FVector2f UV;
+	};
+	static_assert(sizeof(FCachedCorner) == 40, "FCachedCorner is written as raw bytes");
+
+	/** Writes or reads Num raw elements */
+	template <typename T>
+	void SerializeArray(FArchive &Ar, TArray<T> &Array, int32 Num)
+	{
+		if (Ar.IsLoading())
+			Array.SetNumUninitialized(Num);
+		Ar.Serialize(Array.GetData(), (int64)Num * sizeof(T));
+	}
+
+	/** Recreates a description from its cached vertices and corners; false if a corner is out of range */
+	bool RebuildMesh(FMeshDescription &Out, const TArray<FVector3f> &Positions, const TArray<FCachedCorner> &Corners)
+	{
+		Out = FMeshDescription();
+		if (Corners.Num() == 0)
+			return true;
+
+		FStaticMeshAttributes attributes(Out);
+		attributes.Register();
+		TVertexAttributesRef<FVector3f> positions = attributes.GetVertexPositions();
+		TVertexInstanceAttributesRef<FVector3f> normals = attributes.GetVertexInstanceNormals();
+		TVertexInstanceAttributesRef<FVector3f> tangents = attributes.GetVertexInstanceTangents();
+		TVertexInstanceAttributesRef<float> binormalSigns = attributes.GetVertexInstanceBinormalSigns();
+		TVertexInstanceAttributesRef<FVector2f> uvs = attributes.GetVertexInstanceUVs();
+
+		Out.ReserveNewVertices(Positions.Num());
+		Out.ReserveNewVertexInstances(Corners.Num());
+		Out.ReserveNewTriangles(Corners.Num() / 3);
+		const FPolygonGroupID group = Out.CreatePolygonGroup();
+		for (const FVector3f &position : Positions)
+			positions[Out.CreateVertex()] = position;
+
+		for (int32 i = 0; i < Corners.Num(); i += 3)
+		{
+			FVertexInstanceID instances[3];
+			for (int32 c = 0; c < 3; ++c)
+			{
+				const FCachedCorner &corner = Corners[i + c];
+				if (!Positions.IsValidIndex(corner.Vertex))
+					return false;
+				instances[c] = Out.CreateVertexInstance(FVertexID(corner.Vertex));
+				normals[instances[c]] = corner.Normal;
+				tangents[instances[c]] = corner.Tangent;
+				binormalSigns[instances[c]] = corner.BinormalSign;
+				uvs[instances[c]] = corner.UV;
+			}
+			Out.CreateTriangle(group, MakeArrayView(instances));
+		}
+		return true;
+	}
+}
+
+uint64 MujocoMeshCache::HashModelMeshes(const mjModel *Model)
+{
+	FXxHash64Builder builder;
+	builder.Update(&CacheVersion, sizeof(CacheVersion));
+	builder.Update(&Model->nmesh, sizeof(Model->nmesh));
+	for (int32 MeshId = 0; MeshId < Model->nmesh; ++MeshId)
+	{
+		const uint64 meshHash = MujocoMeshConversion::HashMesh(Model, MeshId);
+		builder.Update(&meshHash, sizeof(meshHash));
+	}
+	return builder.Finalize().Hash;
+}
+
+FString MujocoMeshCache::GetCachePath(uint64 ModelHash)
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("MuJoCo"), TEXT("MeshCache"), FString::Printf(TEXT("%016llx.mjmesh"), ModelHash));
+}
+
+bool MujocoMeshCache::Save(const FString &Path, uint64 ModelHash, const TArray<FMeshDescription> &Meshes)
+{
+	TArray<uint8> bytes;
+	FMemoryWriter writer(bytes);
+	uint32 magic = CacheMagic;
+	uint32 version = CacheVersion;
+	int32 numMeshes = Meshes.Num();
+	writer << magic << version << ModelHash << numMeshes;
+
+	TArray<FVector3f> positions;
+	TArray<FCachedCorner> corners;
+	for (const FMeshDescription &mesh : Meshes)
+	{
+		positions.Reset();
+		corners.Reset();
+		if (!mesh.IsEmpty())
+		{
+			// Corners refer to vertices by id, which only works for compact ids as BuildMeshDescription creates them
+			if (mesh.Vertices().Num() != mesh.Vertices().GetArraySize())
+				return false;
+			FStaticMeshConstAttributes attributes(mesh);
+			TVertexAttributesConstRef<FVector3f> meshPositions = attributes.GetVertexPositions();
+			TVertexInstanceAttributesConstRef<FVector3f> normals = attributes.GetVertexInstanceNormals();
+			TVertexInstanceAttributesConstRef<FVector3f> tangents = attributes.GetVertexInstanceTangents();
+			TVertexInstanceAttributesConstRef<float> binormalSigns = attributes.GetVertexInstanceBinormalSigns();
+			TVertexInstanceAttributesConstRef<FVector2f> uvs = attributes.GetVertexInstanceUVs();
+
+			positions.Reserve(mesh.Vertices().Num());
+			for (const FVertexID vertex : mesh.Vertices().GetElementIDs())
+				positions.Add(meshPositions[vertex]);
+			corners.Reserve(mesh.VertexInstances().Num());
+			for (const FTriangleID triangle : mesh.Triangles().GetElementIDs())
+			{
+				for (const FVertexInstanceID instance : mesh.GetTriangleVertexInstances(triangle))
+				{
+					FCachedCorner &corner = corners.AddDefaulted_GetRef();
+					corner.Vertex = mesh.GetVertexInstanceVertex(instance).GetValue();
+					corner.Normal = normals[instance];
+					corner.Tangent = tangents[instance];
+					corner.BinormalSign = binormalSigns[instance];
+					corner.UV = uvs[instance];
+				}
+			}
+		}
+		int32 numVertices = positions.Num();
+		int32 numCorners = corners.Num();
+		writer << numVertices << numCorners;
+		SerializeArray(writer, positions, numVertices);
+		SerializeArray(writer, corners, numCorners);
+	}
+
+	// Trailing checksum catches truncated or damaged files
+	uint64 checksum = FXxHash64::HashBuffer(bytes.GetData(), bytes.Num()).Hash;
+	writer << checksum;
+
+	// Write under a unique name and move it in place, so concurrent servers never read a partial file
+	const FString tempPath = FString::Printf(TEXT("%s.%s.tmp"), *Path, *FGuid::NewGuid().ToString());
+	if (!FFileHelper::SaveArrayToFile(bytes, *tempPath))
+		return false;
+	if (!IFileManager::Get().Move(*Path, *tempPath, true))
+	{
+		IFileManager::Get().Delete(*tempPath);
+		return false;
+	}
+	return true;
+}
+
+bool MujocoMeshCache::Load(const FString &Path, uint64 ModelHash, int32 NumMeshes, TArray<FMeshDescription> &Out)
+{
+	// Map the file; fall back to reading it where the platform cannot map files
+	IPlatformFile &platformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (!platformFile.FileExists(*Path))
+		return false;
+	TUniquePtr<IMappedFileHandle> handle(platformFile.OpenMapped(*Path));
+	TUniquePtr<IMappedFileRegion> region(handle ? handle->MapRegion() : nullptr);
+	TArray<uint8> fileBytes;
+	TArrayView<const uint8> data;
+	if (region)
+		data = TArrayView<const uint8>(region->GetMappedPtr(), region->GetMappedSize());
+	else if (FFileHelper::LoadFileToArray(fileBytes, *Path, FILEREAD_Silent))
+		data = fileBytes;
+	else
+		return false;
+
+	if (data.Num() < (int32)sizeof(uint64))
+		return false;
+	const int32 bodySize = data.Num() - sizeof(uint64);
+	uint64 checksum;
+	FMemory::Memcpy(&checksum, data.GetData() + bodySize, sizeof(checksum));
+	if (FXxHash64::HashBuffer(data.GetData(), bodySize).Hash != checksum)
+		return false;
+
+	FMemoryReaderView reader(data.Left(bodySize));
+	uint32 magic = 0;
+	uint32 version = 0;
+	uint64 hash = 0;
+	int32 numMeshes = 0;
+	reader << magic << version << hash << numMeshes;
+	if (reader.IsError() || magic != CacheMagic || version != CacheVersion || hash != ModelHash || numMeshes != NumMeshes)
+		return false;
+
+	Out.SetNum(NumMeshes);
+	TArray<FVector3f> positions;
+	TArray<FCachedCorner> corners;
+	for (FMeshDescription &mesh : Out)
+	{
+		int32 numVertices = 0;
+		int32 numCorners = 0;
+		reader << numVertices << numCorners;
+		const int64 remaining = reader.TotalSize() - reader.Tell();
+		if (reader.IsError() || numVertices < 0 || numCorners < 0 || numCorners % 3 != 0 ||
+			(int64)numVertices * sizeof(FVector3f) + (int64)numCorners * sizeof(FCachedCorner) > remaining)
+			return false;
+		SerializeArray(reader, positions, numVertices);
+		SerializeArray(reader, corners, numCorners);
+		if (reader.IsError() || !RebuildMesh(mesh, positions, corners))
+			return false;
+	}
+	return true;
+}
+
+void MujocoMeshCache::BuildMeshDescriptions(const mjModel *Model, TArray<FMeshDescription> &Out, TFunctionRef<void(int32 MeshId)> OnConverted)
+{
+	const uint64 hash = HashModelMeshes(Model);
+	const FString path = GetCachePath(hash);
+	if (Load(path, hash, Model->nmesh, Out))
+	{
+		UE_LOG(LogTemp, Log, TEXT("Loaded %d MuJoCo meshes from %s"), Model->nmesh, *path);
+		for (int32 MeshId = 0; MeshId < Model->nmesh; ++MeshId)
+			OnConverted(MeshId);
+		return;
+	}
+
+	MujocoMeshConversion::BuildMeshDescriptions(Model, Out, OnConverted);
+	if (!Save(path, hash, Out))
+		UE_LOG(LogTemp, Warning, TEXT("Could not write MuJoCo mesh cache %s"), *path);
+}
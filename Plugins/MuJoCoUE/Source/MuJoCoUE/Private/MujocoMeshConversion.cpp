@@ -0,0 +1,146 @@
+#include "MujocoMeshConversion.h"
+
+#include "MujocoPoseConversion.h"
+
+#include "Async/ParallelFor.h"
+#include "Hash/xxhash.h"
+#include "KismetProceduralMeshLibrary.h"
+#include "StaticMeshAttributes.h"
+#include "StaticMeshOperations.h"
+
+uint64 MujocoMeshConversion::HashMesh(const mjModel *Model, int32 MeshId)
+{
+	const int32 numVertices = Model->mesh_vertnum[MeshId];
+	const int32 numFaces = Model->mesh_facenum[MeshId];
+	FXxHash64Builder builder;
+	builder.Update(&numVertices, sizeof(numVertices));
+	builder.Update(&numFaces, sizeof(numFaces));
+	builder.Update(Model->mesh_vert + 3 * Model->mesh_vertadr[MeshId], 3 * numVertices * sizeof(float));
+	builder.Update(Model->mesh_face + 3 * Model->mesh_faceadr[MeshId], 3 * numFaces * sizeof(int));
+	const int32 numNormals = Model->mesh_normalnum[MeshId];
+	builder.Update(&numNormals, sizeof(numNormals));
+	builder.Update(Model->mesh_normal + 3 * Model->mesh_normaladr[MeshId], 3 * numNormals * sizeof(float));
+	builder.Update(Model->mesh_facenormal + 3 * Model->mesh_faceadr[MeshId], 3 * numFaces * sizeof(int));
+	const int32 texcoordAdr = Model->mesh_texcoordadr[MeshId];
+	if (texcoordAdr >= 0)
+	{
+		builder.Update(Model->mesh_texcoord + 2 * texcoordAdr, 2 * Model->mesh_texcoordnum[MeshId] * sizeof(float));
+		builder.Update(Model->mesh_facetexcoord + 3 * Model->mesh_faceadr[MeshId], 3 * numFaces * sizeof(int));
+	}
+	return builder.Finalize().Hash;
+}
+
+void MujocoMeshConversion::ConvertMesh(const mjModel *Model, int32 MeshId, FMujocoConvertedMesh &Out)
+{
+	Out = FMujocoConvertedMesh();
+	const int32 numVertices = Model->mesh_vertnum[MeshId];
+	const int32 numFaces = Model->mesh_facenum[MeshId];
+	if (numVertices == 0 || numFaces == 0)
+		return;
+	const float *vertices = Model->mesh_vert + 3 * Model->mesh_vertadr[MeshId];
+	const int *faces = Model->mesh_face + 3 * Model->mesh_faceadr[MeshId];
+
+	// Convert vertices to Unreal coordinates: metres to cm, Y flipped for left-handed
+	const double scale = MujocoPoseConversion::UnitsPerMeter;
+	Out.Vertices.SetNumUninitialized(numVertices);
+	for (int32 i = 0; i < numVertices; ++i)
+	{
+		const float *v = vertices + 3 * i;
+		Out.Vertices[i] = FVector(v[0] * scale, -v[1] * scale, v[2] * scale);
+	}
+
+	// Convert faces to Unreal winding order (CW instead of MuJoCo's CCW)
+	Out.Triangles.SetNumUninitialized(3 * numFaces);
+	for (int32 i = 0; i < numFaces; ++i)
+	{
+		const int *f = faces + 3 * i;
+		Out.Triangles[3 * i + 0] = f[0];
+		Out.Triangles[3 * i + 1] = f[2];
+		Out.Triangles[3 * i + 2] = f[1];
+	}
+
+	// Generate normals/tangents (using placeholder UVs)
+	Out.UVs.Init(FVector2D(0.5f, 0.5f), numVertices);
+	UKismetProceduralMeshLibrary::CalculateTangentsForMesh(Out.Vertices, Out.Triangles, Out.UVs, Out.Normals, Out.Tangents);
+}
+
+void MujocoMeshConversion::ConvertMeshes(const mjModel *Model, TArray<FMujocoConvertedMesh> &Out, TFunctionRef<void(int32 MeshId)> OnConverted)
+{
+	Out.SetNum(Model->nmesh);
+	// Mesh sizes vary by orders of magnitude, so let idle workers pick up meshes one at a time
+	ParallelFor(Model->nmesh, [Model, &Out, &OnConverted](int32 MeshId)
+	{
+		ConvertMesh(Model, MeshId, Out[MeshId]);
+		OnConverted(MeshId);
+	}, EParallelForFlags::Unbalanced);
+}
+
+bool MujocoMeshConversion::BuildMeshDescription(const mjModel *Model, int32 MeshId, FMeshDescription &Out)
+{
+	Out = FMeshDescription();
+	const int32 numVertices = Model->mesh_vertnum[MeshId];
+	const int32 numFaces = Model->mesh_facenum[MeshId];
+	if (numVertices == 0 || numFaces == 0)
+		return false;
+	const int32 faceAdr = Model->mesh_faceadr[MeshId];
+	const float *vertices = Model->mesh_vert + 3 * Model->mesh_vertadr[MeshId];
+	const int *faces = Model->mesh_face + 3 * faceAdr;
+	// Face normal and texcoord indices are relative to the mesh, like the vertex indices
+	const float *normals = Model->mesh_normalnum[MeshId] > 0 ? Model->mesh_normal + 3 * Model->mesh_normaladr[MeshId] : nullptr;
+	const int *faceNormals = Model->mesh_facenormal + 3 * faceAdr;
+	const float *texcoords = Model->mesh_texcoordadr[MeshId] >= 0 ? Model->mesh_texcoord + 2 * Model->mesh_texcoordadr[MeshId] : nullptr;
+	const int *faceTexcoords = Model->mesh_facetexcoord + 3 * faceAdr;
+
+	FStaticMeshAttributes attributes(Out);
+	attributes.Register();
+	TVertexAttributesRef<FVector3f> positions = attributes.GetVertexPositions();
+	TVertexInstanceAttributesRef<FVector3f> instanceNormals = attributes.GetVertexInstanceNormals();
+	TVertexInstanceAttributesRef<FVector2f> instanceUVs = attributes.GetVertexInstanceUVs();
+
+	Out.ReserveNewVertices(numVertices);
+	Out.ReserveNewVertexInstances(3 * numFaces);
+	Out.ReserveNewTriangles(numFaces);
+	const FPolygonGroupID group = Out.CreatePolygonGroup();
+
+	// Same conventions as ConvertMesh: metres to cm, Y flipped for left-handed
+	const float scale = MujocoPoseConversion::UnitsPerMeter;
+	for (int32 i = 0; i < numVertices; ++i)
+	{
+		const float *v = vertices + 3 * i;
+		positions[Out.CreateVertex()] = FVector3f(v[0] * scale, -v[1] * scale, v[2] * scale);
+	}
+
+	// Corners are taken in 0, 2, 1 order to keep the faces pointing out after the flip
+	constexpr int32 cornerOrder[3] = {0, 2, 1};
+	for (int32 i = 0; i < numFaces; ++i)
+	{
+		FVertexInstanceID corners[3];
+		for (int32 c = 0; c < 3; ++c)
+		{
+			const int32 k = 3 * i + cornerOrder[c];
+			corners[c] = Out.CreateVertexInstance(FVertexID(faces[k]));
+			if (normals)
+			{
+				const float *n = normals + 3 * faceNormals[k];
+				instanceNormals[corners[c]] = FVector3f(n[0], -n[1], n[2]);
+			}
+			const float *t = texcoords ? texcoords + 2 * faceTexcoords[k] : nullptr;
+			instanceUVs[corners[c]] = t ? FVector2f(t[0], t[1]) : FVector2f(0.5f, 0.5f);
+		}
+		Out.CreateTriangle(group, MakeArrayView(corners));
+	}
+
+	FStaticMeshOperations::ComputeTriangleTangentsAndNormals(Out);
+	FStaticMeshOperations::ComputeTangentsAndNormals(Out, normals ? EComputeNTBsFlags::Tangents : EComputeNTBsFlags::Normals | EComputeNTBsFlags::Tangents);
+	return true;
+}
+
+void MujocoMeshConversion::BuildMeshDescriptions(const mjModel *Model, TArray<FMeshDescription> &Out, TFunctionRef<void(int32 MeshId)> OnConverted)
+{
+	Out.SetNum(Model->nmesh);
+	ParallelFor(Model->nmesh, [Model, &Out, &OnConverted](int32 MeshId)
+	{
+		BuildMeshDescription(Model, MeshId, Out[MeshId]);
+		OnConverted(MeshId);
+	}, EParallelForFlags::Unbalanced);
+}
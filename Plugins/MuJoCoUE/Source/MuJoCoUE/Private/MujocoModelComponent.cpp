@@ -0,0 +1,293 @@
+#include "MujocoModelComponent.h"
+
+#include "MujocoPoseBuffer.h"
+
+#include "Engine/CollisionProfile.h"
+#include "Engine/StaticMesh.h"
+#include "Materials/Material.h"
+#include "Materials/MaterialRenderProxy.h"
+#include "MeshBatch.h"
+#include "PrimitiveSceneProxy.h"
+#include "PrimitiveViewRelevance.h"
+#include "RenderingThread.h"
+#include "SceneInterface.h"
+#include "SceneManagement.h"
+#include "StaticMeshResources.h"
+
+namespace
+{
+	/** Vector parameter the geom color is passed through, as in AMuJoCoSimulation::SetMeshColor */
+	const FName ColorParameterName(TEXT("BaseColor"));
+
+	/**
+	 * Scene proxy drawing all geoms of a UMujocoModelComponent.
+	 *
+	 * Holds the static mesh render data and a component space matrix per geom. Every frame it
+	 * emits one mesh batch per geom section and visible view, each geom with its own primitive
+	 * uniform buffer.
+	 */
+	class FMujocoModelSceneProxy final : public FPrimitiveSceneProxy
+	{
+	public:
+		FMujocoModelSceneProxy(const UMujocoModelComponent *Component)
+			: FPrimitiveSceneProxy(Component)
+			, MaterialRelevance(Component->GetMaterialRelevance(GetScene().GetFeatureLevel()))
+		{
+			const TArray<FMujocoModelGeom> &geoms = Component->GetGeoms();
+			Geoms.SetNum(geoms.Num());
+			for (int32 i = 0; i < geoms.Num(); ++i)
+			{
+				const FMujocoModelGeom &geom = geoms[i];
+				FGeomDraw &draw = Geoms[i];
+				draw.LocalToComponent = Component->GetGeomTransform(i).ToMatrixWithScale();
+
+				const FStaticMeshRenderData *renderData = geom.Mesh ? geom.Mesh->GetRenderData() : nullptr;
+				if (!renderData || renderData->LODResources.Num() == 0 || renderData->LODVertexFactories.Num() == 0)
+					continue;
+				draw.RenderData = renderData;
+				draw.LocalBounds = geom.Mesh->GetBounds();
+				// The geom color is applied on top of the material, like the per component material instances do
+				for (const FStaticMeshSection &section : renderData->LODResources[0].Sections)
+				{
+					const UMaterialInterface *material = Component->GetGeomMaterial(i, section.MaterialIndex);
+					ColorProxies.Add(MakeUnique<FColoredMaterialRenderProxy>(material->GetRenderProxy(), geom.Color, ColorParameterName));
+					draw.SectionMaterials.Add(ColorProxies.Last().Get());
+				}
+			}
+		}
+
+		virtual SIZE_T GetTypeHash() const override
+		{
+			static size_t UniquePointer;
+			return reinterpret_cast<size_t>(&UniquePointer);
+		}
+
+		/** Applies the matrices of the geoms that moved; Indices are draw indices */
+		void SetGeomPoses_RenderThread(const TArray<int32> &Indices, const TArray<FMatrix> &Matrices)
+		{
+			check(IsInRenderingThread());
+			const uint32 frame = GFrameNumberRenderThread;
+			for (int32 i = 0; i < Indices.Num(); ++i)
+			{
+				FGeomDraw &geom = Geoms[Indices[i]];
+				// The first update of a frame starts its motion from the pose drawn last frame
+				if (geom.UpdateFrame != frame)
+					geom.PreviousLocalToComponent = geom.LocalToComponent;
+				geom.LocalToComponent = Matrices[i];
+				geom.UpdateFrame = frame;
+			}
+		}
+
+		virtual void GetDynamicMeshElements(const TArray<const FSceneView *> &Views, const FSceneViewFamily &ViewFamily, uint32 VisibilityMap, FMeshElementCollector &Collector) const override
+		{
+			QUICK_SCOPE_CYCLE_COUNTER(STAT_MujocoModelSceneProxy_GetDynamicMeshElements);
+
+			bool bHasPrecomputedVolumetricLightmap;
+			FMatrix previousLocalToWorld;
+			int32 singleCaptureIndex;
+			bool bOutputVelocity;
+			GetScene().GetPrimitiveUniformShaderParameters_RenderThread(GetPrimitiveSceneInfo(), bHasPrecomputedVolumetricLightmap, previousLocalToWorld, singleCaptureIndex, bOutputVelocity);
+
+			const FMatrix &componentToWorld = GetLocalToWorld();
+			const bool bReverseCulling = IsLocalToWorldDeterminantNegative();
+			for (const FGeomDraw &geom : Geoms)
+			{
+				if (!geom.RenderData)
+					continue;
+				const FMatrix localToWorld = geom.LocalToComponent * componentToWorld;
+				// Geoms not updated this frame did not move relative to the component
+				const FMatrix &previousLocalToComponent = geom.UpdateFrame == GFrameNumberRenderThread ? geom.PreviousLocalToComponent : geom.LocalToComponent;
+				const FMatrix previousGeomToWorld = previousLocalToComponent * previousLocalToWorld;
+				const FBoxSphereBounds worldBounds = geom.LocalBounds.TransformBy(localToWorld);
+
+				FDynamicPrimitiveUniformBuffer &uniformBuffer = Collector.AllocateOneFrameResource<FDynamicPrimitiveUniformBuffer>();
+				uniformBuffer.Set(Collector.GetRHICommandList(), localToWorld, previousGeomToWorld, worldBounds, geom.LocalBounds, geom.LocalBounds, true, bHasPrecomputedVolumetricLightmap, true, GetCustomPrimitiveData());
+
+				const FStaticMeshLODResources &lod = geom.RenderData->LODResources[0];
+				const FLocalVertexFactory &vertexFactory = geom.RenderData->LODVertexFactories[0].VertexFactory;
+				for (int32 SectionIndex = 0; SectionIndex < lod.Sections.Num(); ++SectionIndex)
+				{
+					const FStaticMeshSection &section = lod.Sections[SectionIndex];
+					if (section.NumTriangles == 0)
+						continue;
+					for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ++ViewIndex)
+					{
+						// Frustum culling is left to the primitive bounds: shadow passes gather with the
+						// camera views, and geoms just off screen still cast shadows into them
+						if (!(VisibilityMap & (1 << ViewIndex)))
+							continue;
+						FMeshBatch &mesh = Collector.AllocateMesh();
+						mesh.VertexFactory = &vertexFactory;
+						mesh.MaterialRenderProxy = geom.SectionMaterials[SectionIndex];
+						mesh.ReverseCulling = bReverseCulling;
+						mesh.Type = PT_TriangleList;
+						mesh.DepthPriorityGroup = SDPG_World;
+						mesh.CastShadow = section.bCastShadow;
+						mesh.LODIndex = 0;
+						mesh.bCanApplyViewModeOverrides = false;
+
+						FMeshBatchElement &element = mesh.Elements[0];
+						element.IndexBuffer = &lod.IndexBuffer;
+						element.FirstIndex = section.FirstIndex;
+						element.NumPrimitives = section.NumTriangles;
+						element.MinVertexIndex = section.MinVertexIndex;
+						element.MaxVertexIndex = section.MaxVertexIndex;
+						element.VertexFactoryUserData = vertexFactory.GetUniformBuffer();
+						element.PrimitiveUniformBufferResource = &uniformBuffer.UniformBuffer;
+						Collector.AddMesh(ViewIndex, mesh);
+					}
+				}
+			}
+		}
+
+		virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView *View) const override
+		{
+			FPrimitiveViewRelevance result;
+			result.bDrawRelevance = IsShown(View);
+			result.bShadowRelevance = IsShadowCast(View);
+			result.bDynamicRelevance = true;
+			result.bRenderInMainPass = ShouldRenderInMainPass();
+			result.bUsesLightingChannels = GetLightingChannelMask() != GetDefaultLightingChannelMask();
+			result.bRenderCustomDepth = ShouldRenderCustomDepth();
+			MaterialRelevance.SetPrimitiveViewRelevance(result);
+			result.bVelocityRelevance = DrawsVelocity() && result.bOpaque && result.bRenderInMainPass;
+			return result;
+		}
+
+		virtual bool CanBeOccluded() const override
+		{
+			return !MaterialRelevance.bDisableDepthTest;
+		}
+
+		virtual uint32 GetMemoryFootprint() const override
+		{
+			return sizeof(*this) + GetAllocatedSize();
+		}
+
+		uint32 GetAllocatedSize() const
+		{
+			return FPrimitiveSceneProxy::GetAllocatedSize() + Geoms.GetAllocatedSize() + ColorProxies.GetAllocatedSize() + ColorProxies.Num() * sizeof(FColoredMaterialRenderProxy);
+		}
+
+	private:
+		struct FGeomDraw
+		{
+			/** Null if the geom has no mesh to draw */
+			const FStaticMeshRenderData *RenderData = nullptr;
+			/** One material per LOD 0 section */
+			TArray<const FMaterialRenderProxy *, TInlineAllocator<1>> SectionMaterials;
+			FBoxSphereBounds LocalBounds = FBoxSphereBounds(ForceInit);
+			FMatrix LocalToComponent = FMatrix::Identity;
+			/** Pose drawn the frame before UpdateFrame, for motion vectors */
+			FMatrix PreviousLocalToComponent = FMatrix::Identity;
+			/** Render thread frame of the last pose update */
+			uint32 UpdateFrame = 0;
+		};
+
+		TArray<FGeomDraw> Geoms;
+		TArray<TUniquePtr<FColoredMaterialRenderProxy>> ColorProxies;
+		FMaterialRelevance MaterialRelevance;
+	};
+}
+
+UMujocoModelComponent::UMujocoModelComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+	SetCollisionProfileName(UCollisionProfile::NoCollision_ProfileName);
+	SetGenerateOverlapEvents(false);
+}
+
+void UMujocoModelComponent::SetGeoms(const TArray<FMujocoModelGeom> &InGeoms)
+{
+	Geoms = InGeoms;
+	GeomTransforms.Reset(Geoms.Num());
+	GeomRadii.Reset(Geoms.Num());
+	for (const FMujocoModelGeom &geom : Geoms)
+	{
+		GeomTransforms.Add(FTransform(FQuat::Identity, FVector::ZeroVector, geom.Scale));
+		const FBoxSphereBounds bounds = geom.Mesh ? geom.Mesh->GetBounds() : FBoxSphereBounds(ForceInit);
+		GeomRadii.Add((bounds.Origin.Size() + bounds.SphereRadius) * geom.Scale.GetAbsMax());
+	}
+	const FBox box = ComputeGeomBox();
+	PaddedBox = box.IsValid ? box.ExpandBy(box.GetExtent() * BoundsSlack) : box;
+	UpdateBounds();
+	MarkRenderStateDirty();
+}
+
+void UMujocoModelComponent::UpdatePoses(const FMujocoPoseBuffer &Poses)
+{
+	TArray<int32> indices;
+	TArray<FMatrix> matrices;
+	for (int32 i = 0; i < Geoms.Num(); ++i)
+	{
+		const int32 geomId = Geoms[i].GeomId;
+		if (!Poses.GeomDirty[geomId])
+			continue;
+		FTransform &transform = GeomTransforms[i];
+		transform.SetLocation(Poses.GeomPositions[geomId]);
+		transform.SetRotation(Poses.GeomRotations[geomId]);
+		indices.Add(i);
+		matrices.Add(transform.ToMatrixWithScale());
+	}
+	if (indices.Num() == 0)
+		return;
+
+	// Padded bounds leave room to move, so they are only pushed again when a geom leaves them
+	const FBox box = ComputeGeomBox();
+	if (box.IsValid && !PaddedBox.IsInside(box))
+	{
+		PaddedBox = box.ExpandBy(box.GetExtent() * BoundsSlack);
+		UpdateBounds();
+		MarkRenderTransformDirty();
+	}
+
+	FMujocoModelSceneProxy *proxy = static_cast<FMujocoModelSceneProxy *>(SceneProxy);
+	if (!proxy)
+		return;
+	// The proxy is destroyed by a later render command, so it outlives this one
+	ENQUEUE_RENDER_COMMAND(MujocoSetGeomPoses)(
+		[proxy, indices = MoveTemp(indices), matrices = MoveTemp(matrices)](FRHICommandListImmediate &)
+		{
+			proxy->SetGeomPoses_RenderThread(indices, matrices);
+		});
+}
+
+FBox UMujocoModelComponent::ComputeGeomBox() const
+{
+	FBox box(ForceInit);
+	for (int32 i = 0; i < GeomTransforms.Num(); ++i)
+		box += FBox::BuildAABB(GeomTransforms[i].GetLocation(), FVector(GeomRadii[i]));
+	return box;
+}
+
+FPrimitiveSceneProxy *UMujocoModelComponent::CreateSceneProxy()
+{
+	if (Geoms.Num() == 0)
+		return nullptr;
+	return new FMujocoModelSceneProxy(this);
+}
+
+FBoxSphereBounds UMujocoModelComponent::CalcBounds(const FTransform &LocalToWorld) const
+{
+	if (!PaddedBox.IsValid)
+		return FBoxSphereBounds(LocalToWorld.GetLocation(), FVector::ZeroVector, 0);
+	return FBoxSphereBounds(PaddedBox).TransformBy(LocalToWorld);
+}
+
+UMaterialInterface *UMujocoModelComponent::GetGeomMaterial(int32 Index, int32 MaterialIndex) const
+{
+	const FMujocoModelGeom &geom = Geoms[Index];
+	UMaterialInterface *material = geom.Material ? geom.Material : (geom.Mesh ? geom.Mesh->GetMaterial(MaterialIndex) : nullptr);
+	return material ? material : UMaterial::GetDefaultMaterial(MD_Surface);
+}
+
+void UMujocoModelComponent::GetUsedMaterials(TArray<UMaterialInterface *> &OutMaterials, bool bGetDebugMaterials) const
+{
+	for (int32 i = 0; i < Geoms.Num(); ++i)
+	{
+		const UStaticMesh *mesh = Geoms[i].Mesh;
+		const int32 numMaterials = mesh ? FMath::Max(mesh->GetStaticMaterials().Num(), 1) : 1;
+		for (int32 MaterialIndex = 0; MaterialIndex < numMaterials; ++MaterialIndex)
+			OutMaterials.AddUnique(GetGeomMaterial(i, MaterialIndex));
+	}
+}
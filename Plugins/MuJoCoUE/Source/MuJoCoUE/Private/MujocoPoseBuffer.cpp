@@ -0,0 +1,100 @@
+#include "MujocoPoseBuffer.h"
+
+#include "MujocoPoseConversion.h"
+
+void FMujocoPoseBuffer::Initialize(int32 NumBodies, int32 NumGeoms)
+{
+	BodyPositions.Init(FVector::ZeroVector, NumBodies);
+	BodyRotations.Init(FQuat::Identity, NumBodies);
+	GeomPositions.Init(FVector::ZeroVector, NumGeoms);
+	GeomRotations.Init(FQuat::Identity, NumGeoms);
+	BodyDirty.Init(1, NumBodies);
+	GeomDirty.Init(1, NumGeoms);
+	DeferredGeomDirty.Init(0, NumGeoms);
+}
+
+void FMujocoPoseBuffer::SetBodies(const mjtNum *XPos, const mjtNum *XQuat)
+{
+	MujocoPoseConversion::ForEachChunk(BodyPositions.Num(), [this, XPos, XQuat](int32 Start, int32 Num)
+	{
+		MujocoPoseConversion::ConvertPositions(XPos + 3 * Start, BodyPositions.GetData() + Start, Num);
+		MujocoPoseConversion::ConvertQuats(XQuat + 4 * Start, BodyRotations.GetData() + Start, Num);
+	});
+}
+
+void FMujocoPoseBuffer::SetGeoms(const mjtNum *XPos, const mjtNum *XMat)
+{
+	MujocoPoseConversion::ForEachChunk(GeomPositions.Num(), [this, XPos, XMat](int32 Start, int32 Num)
+	{
+		MujocoPoseConversion::ConvertPositions(XPos + 3 * Start, GeomPositions.GetData() + Start, Num);
+		MujocoPoseConversion::ConvertMatrices(XMat + 9 * Start, GeomRotations.GetData() + Start, Num);
+	});
+}
+
+void FMujocoPoseBuffer::MarkMoved(const uint64 *BodyChangeIndex, uint64 Since, const int *GeomBodyId)
+{
+	const int32 numBodies = BodyDirty.Num();
+	uint8 *bodyDirty = BodyDirty.GetData();
+	for (int32 i = 0; i < numBodies; ++i)
+		bodyDirty[i] |= BodyChangeIndex[i] > Since;
+
+	// Geoms are rigidly attached, so they move exactly when their body does
+	const int32 numGeoms = GeomDirty.Num();
+	uint8 *geomDirty = GeomDirty.GetData();
+	for (int32 i = 0; i < numGeoms; ++i)
+		geomDirty[i] |= BodyChangeIndex[GeomBodyId[i]] > Since;
+}
+
+float FMujocoPoseBuffer::GetDirtyFraction() const
+{
+	const TArray<uint8> &flags = GeomDirty.Num() ? GeomDirty : BodyDirty;
+	if (flags.Num() == 0)
+		return 0;
+	int32 dirty = 0;
+	for (const uint8 flag : flags)
+		dirty += flag != 0;
+	return (float)dirty / flags.Num();
+}
+
+void FMujocoPoseBuffer::SetBody(int32 Index, const FVector &Position, const FQuat &Rotation)
+{
+	BodyDirty[Index] |= BodyPositions[Index] != Position || BodyRotations[Index] != Rotation;
+	BodyPositions[Index] = Position;
+	BodyRotations[Index] = Rotation;
+}
+
+void FMujocoPoseBuffer::SetGeom(int32 Index, const FVector &Position, const FQuat &Rotation)
+{
+	GeomDirty[Index] |= GeomPositions[Index] != Position || GeomRotations[Index] != Rotation;
+	GeomPositions[Index] = Position;
+	GeomRotations[Index] = Rotation;
+}
+
+void FMujocoPoseBuffer::MarkAllDirty()
+{
+	FMemory::Memset(BodyDirty.GetData(), 1, BodyDirty.Num());
+	FMemory::Memset(GeomDirty.GetData(), 1, GeomDirty.Num());
+}
+
+void FMujocoPoseBuffer::DeferGeoms(const uint8 *Visible)
+{
+	const int32 count = GeomDirty.Num();
+	uint8 *dirty = GeomDirty.GetData();
+	uint8 *deferred = DeferredGeomDirty.GetData();
+	for (int32 i = 0; i < count; ++i)
+	{
+		if (dirty[i] && !Visible[i])
+		{
+			deferred[i] = 1;
+			dirty[i] = 0;
+		}
+	}
+}
+
+void FMujocoPoseBuffer::ClearDirty()
+{
+	FMemory::Memzero(BodyDirty.GetData(), BodyDirty.Num());
+	// Held back geoms stay dirty until they are visible again
+	Swap(GeomDirty, DeferredGeomDirty);
+	FMemory::Memzero(DeferredGeomDirty.GetData(), DeferredGeomDirty.Num());
+}
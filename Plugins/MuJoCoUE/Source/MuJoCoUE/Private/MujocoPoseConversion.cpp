@@ -0,0 +1,209 @@
+#include "MujocoPoseConversion.h"
+
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/VectorRegister.h"
+
+#include <type_traits>
+
+static_assert(std::is_same_v<mjtNum, double>, "The pose conversion kernels expect MuJoCo built with double precision");
+static_assert(sizeof(FVector) == 3 * sizeof(mjtNum), "FVector arrays are converted as flat double arrays");
+
+static TAutoConsoleVariable<int32> CVarMujocoPoseParallelThreshold(
+	TEXT("mujoco.Pose.ParallelThreshold"),
+	5000,
+	TEXT("Element count from which pose conversion and transform composition are split across task graph workers."));
+
+static TAutoConsoleVariable<int32> CVarMujocoPoseChunkSize(
+	TEXT("mujoco.Pose.ChunkSize"),
+	1024,
+	TEXT("Elements per task when pose conversion runs in parallel."));
+
+namespace
+{
+	// Radicand floor keeping the unused branches of the matrix kernel finite
+	constexpr double MinRadicand = 1e-12;
+
+	/**
+	 * Shepperd's method: pick the largest of the four radicands (trace, and the three
+	 * diagonal combinations) and derive the other components from the off-diagonal terms.
+	 * m is row-major: m[3 * row + column].
+	 */
+	FORCEINLINE void MatrixToQuat(const mjtNum *m, FQuat &Out)
+	{
+		const double t[4] = {
+			1 + m[0] + m[4] + m[8],
+			1 + m[0] - m[4] - m[8],
+			1 - m[0] + m[4] - m[8],
+			1 - m[0] - m[4] + m[8]};
+		int32 best = 0;
+		for (int32 i = 1; i < 4; ++i)
+		{
+			if (t[i] > t[best])
+				best = i;
+		}
+		const double r = FMath::Sqrt(FMath::Max(t[best], MinRadicand));
+		const double k = 0.5 / r;
+		double w, x, y, z;
+		switch (best)
+		{
+		case 0:
+			w = 0.5 * r;
+			x = (m[7] - m[5]) * k;
+			y = (m[2] - m[6]) * k;
+			z = (m[3] - m[1]) * k;
+			break;
+		case 1:
+			x = 0.5 * r;
+			w = (m[7] - m[5]) * k;
+			y = (m[1] + m[3]) * k;
+			z = (m[2] + m[6]) * k;
+			break;
+		case 2:
+			y = 0.5 * r;
+			w = (m[2] - m[6]) * k;
+			x = (m[1] + m[3]) * k;
+			z = (m[5] + m[7]) * k;
+			break;
+		default:
+			z = 0.5 * r;
+			w = (m[3] - m[1]) * k;
+			x = (m[2] + m[6]) * k;
+			y = (m[5] + m[7]) * k;
+			break;
+		}
+		const double invLength = 1.0 / FMath::Sqrt(w * w + x * x + y * y + z * z);
+		Out = FQuat(x * invLength, y * invLength, z * invLength, w * invLength);
+	}
+}
+
+void MujocoPoseConversion::ConvertPositions(const mjtNum *XPos, FVector *OutPositions, int32 Count)
+{
+	if (Count <= 0)
+		return;
+	// Both sides are flat arrays of doubles, so this is one long scaled copy
+	const int32 total = Count * 3;
+	double *out = &OutPositions[0].X;
+	const VectorRegister4Double scale = MakeVectorRegisterDouble(UnitsPerMeter, UnitsPerMeter, UnitsPerMeter, UnitsPerMeter);
+	int32 i = 0;
+	for (; i + 4 <= total; i += 4)
+		VectorStore(VectorMultiply(VectorLoad(XPos + i), scale), out + i);
+	for (; i < total; ++i)
+		out[i] = XPos[i] * UnitsPerMeter;
+}
+
+void MujocoPoseConversion::ConvertQuats(const mjtNum *XQuat, FQuat *OutRotations, int32 Count)
+{
+	for (int32 i = 0; i < Count; ++i)
+	{
+		const mjtNum *q = XQuat + 4 * i;
+		// MuJoCo stores w first, Unreal last
+		OutRotations[i] = FQuat(q[1], q[2], q[3], q[0]);
+	}
+}
+
+void MujocoPoseConversion::ConvertMatricesScalar(const mjtNum *XMat, FQuat *OutRotations, int32 Count)
+{
+	for (int32 i = 0; i < Count; ++i)
+		MatrixToQuat(XMat + 9 * i, OutRotations[i]);
+}
+
+void MujocoPoseConversion::ConvertMatrices(const mjtNum *XMat, FQuat *OutRotations, int32 Count)
+{
+	const VectorRegister4Double one = MakeVectorRegisterDouble(1.0, 1.0, 1.0, 1.0);
+	const VectorRegister4Double half = MakeVectorRegisterDouble(0.5, 0.5, 0.5, 0.5);
+	const VectorRegister4Double minimum = MakeVectorRegisterDouble(MinRadicand, MinRadicand, MinRadicand, MinRadicand);
+
+	int32 i = 0;
+	for (; i + 4 <= Count; i += 4)
+	{
+		// Gather element e of four matrices into one register (structure of arrays)
+		const mjtNum *m = XMat + 9 * i;
+		VectorRegister4Double e[9];
+		for (int32 k = 0; k < 9; ++k)
+			e[k] = MakeVectorRegisterDouble(m[k], m[9 + k], m[18 + k], m[27 + k]);
+
+		const VectorRegister4Double d21 = VectorSubtract(e[7], e[5]);
+		const VectorRegister4Double d02 = VectorSubtract(e[2], e[6]);
+		const VectorRegister4Double d10 = VectorSubtract(e[3], e[1]);
+		const VectorRegister4Double s01 = VectorAdd(e[1], e[3]);
+		const VectorRegister4Double s02 = VectorAdd(e[2], e[6]);
+		const VectorRegister4Double s12 = VectorAdd(e[5], e[7]);
+
+		// The four radicands of Shepperd's method
+		const VectorRegister4Double t0 = VectorAdd(VectorAdd(one, e[0]), VectorAdd(e[4], e[8]));
+		const VectorRegister4Double t1 = VectorSubtract(VectorAdd(one, e[0]), VectorAdd(e[4], e[8]));
+		const VectorRegister4Double t2 = VectorSubtract(VectorAdd(one, e[4]), VectorAdd(e[0], e[8]));
+		const VectorRegister4Double t3 = VectorSubtract(VectorAdd(one, e[8]), VectorAdd(e[0], e[4]));
+
+		// Evaluate every branch, then keep the one with the largest radicand per lane
+		auto branch = [&](const VectorRegister4Double &t, VectorRegister4Double &r, VectorRegister4Double &k)
+		{
+			r = VectorSqrt(VectorMax(t, minimum));
+			k = VectorDivide(half, r);
+			r = VectorMultiply(r, half);
+		};
+		VectorRegister4Double r, k;
+
+		branch(t0, r, k);
+		VectorRegister4Double w = r;
+		VectorRegister4Double x = VectorMultiply(d21, k);
+		VectorRegister4Double y = VectorMultiply(d02, k);
+		VectorRegister4Double z = VectorMultiply(d10, k);
+		VectorRegister4Double best = t0;
+
+		branch(t1, r, k);
+		VectorRegister4Double mask = VectorCompareGT(t1, best);
+		w = VectorSelect(mask, VectorMultiply(d21, k), w);
+		x = VectorSelect(mask, r, x);
+		y = VectorSelect(mask, VectorMultiply(s01, k), y);
+		z = VectorSelect(mask, VectorMultiply(s02, k), z);
+		best = VectorMax(best, t1);
+
+		branch(t2, r, k);
+		mask = VectorCompareGT(t2, best);
+		w = VectorSelect(mask, VectorMultiply(d02, k), w);
+		x = VectorSelect(mask, VectorMultiply(s01, k), x);
+		y = VectorSelect(mask, r, y);
+		z = VectorSelect(mask, VectorMultiply(s12, k), z);
+		best = VectorMax(best, t2);
+
+		branch(t3, r, k);
+		mask = VectorCompareGT(t3, best);
+		w = VectorSelect(mask, VectorMultiply(d10, k), w);
+		x = VectorSelect(mask, VectorMultiply(s02, k), x);
+		y = VectorSelect(mask, VectorMultiply(s12, k), y);
+		z = VectorSelect(mask, r, z);
+
+		const VectorRegister4Double lengthSquared = VectorMultiplyAdd(w, w, VectorMultiplyAdd(x, x, VectorMultiplyAdd(y, y, VectorMultiply(z, z))));
+		const VectorRegister4Double invLength = VectorDivide(one, VectorSqrt(lengthSquared));
+
+		alignas(32) double ow[4], ox[4], oy[4], oz[4];
+		VectorStoreAligned(VectorMultiply(w, invLength), ow);
+		VectorStoreAligned(VectorMultiply(x, invLength), ox);
+		VectorStoreAligned(VectorMultiply(y, invLength), oy);
+		VectorStoreAligned(VectorMultiply(z, invLength), oz);
+		for (int32 lane = 0; lane < 4; ++lane)
+			OutRotations[i + lane] = FQuat(ox[lane], oy[lane], oz[lane], ow[lane]);
+	}
+	ConvertMatricesScalar(XMat + 9 * i, OutRotations + i, Count - i);
+}
+
+void MujocoPoseConversion::ForEachChunk(int32 Count, TFunctionRef<void(int32 Start, int32 Num)> Body)
+{
+	if (Count <= 0)
+		return;
+	if (Count < CVarMujocoPoseParallelThreshold.GetValueOnAnyThread())
+	{
+		Body(0, Count);
+		return;
+	}
+	// Keep chunks a multiple of 4 so every chunk but the last runs the vector kernels without a tail
+	const int32 chunkSize = FMath::Max(Align(CVarMujocoPoseChunkSize.GetValueOnAnyThread(), 4), 4);
+	const int32 numChunks = FMath::DivideAndRoundUp(Count, chunkSize);
+	ParallelFor(numChunks, [&Body, Count, chunkSize](int32 Chunk)
+	{
+		const int32 start = Chunk * chunkSize;
+		Body(start, FMath::Min(chunkSize, Count - start));
+	});
+}
@@ -0,0 +1,287 @@
+#include "MujocoSimulationSubsystem.h"
+
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/ScopeLock.h"
+#include "MujocoWorkerThread.h"
+
+static TAutoConsoleVariable<int32> CVarMujocoSchedulerWorkers(
+	TEXT("mujoco.Scheduler.Workers"),
+	0,
+	TEXT("Number of worker threads of the shared MuJoCo scheduler. 0 uses the core count minus mujoco.Scheduler.ReservedCores."));
+
+static TAutoConsoleVariable<int32> CVarMujocoSchedulerReservedCores(
+	TEXT("mujoco.Scheduler.ReservedCores"),
+	2,
+	TEXT("Cores left to the game and render threads when mujoco.Scheduler.Workers is 0."));
+
+namespace
+{
+	// Longest time an idle worker sleeps before looking for new work
+	constexpr double MaxIdleWait = 0.010;
+	// Below this time to the next due step a worker yields instead of sleeping on its event
+	constexpr double SpinThreshold = 0.001;
+	// Weight of the newest sample in the latency and run-time averages
+	constexpr float StatsSmoothing = 0.05f;
+	// Length of the window used to measure steps per second
+	constexpr double ThroughputWindow = 0.5;
+}
+
+/**
+ * @class FMujocoSchedulerWorker
+ * @brief Runnable of one scheduler worker thread; forwards to UMujocoSimulationSubsystem::RunWorker.
+ */
+class FMujocoSchedulerWorker : public FRunnable
+{
+public:
+	FMujocoSchedulerWorker(UMujocoSimulationSubsystem *InOwner, int32 InIndex)
+		: Owner(InOwner)
+		, Index(InIndex)
+	{
+	}
+
+	virtual uint32 Run() override
+	{
+		Owner->RunWorker(Index);
+		return 0;
+	}
+
+private:
+	UMujocoSimulationSubsystem *Owner;
+	int32 Index;
+};
+
+void UMujocoSimulationSubsystem::Deinitialize()
+{
+	StopWorkers();
+	SharedMeshes.Empty();
+	Super::Deinitialize();
+}
+
+UStaticMesh *UMujocoSimulationSubsystem::FindSharedMesh(uint64 Hash) const
+{
+	UStaticMesh *const *mesh = SharedMeshes.Find(Hash);
+	return mesh ? *mesh : nullptr;
+}
+
+void UMujocoSimulationSubsystem::AddSharedMesh(uint64 Hash, UStaticMesh *Mesh)
+{
+	check(IsInGameThread());
+	SharedMeshes.Add(Hash, Mesh);
+}
+
+void UMujocoSimulationSubsystem::StartWorkers()
+{
+	int32 numWorkers = CVarMujocoSchedulerWorkers.GetValueOnGameThread();
+	if (numWorkers <= 0)
+		numWorkers = FPlatformMisc::NumberOfCoresIncludingHyperthreads() - CVarMujocoSchedulerReservedCores.GetValueOnGameThread();
+	numWorkers = FMath::Max(numWorkers, 1);
+
+	bStopWorkers = false;
+	for (int32 i = 0; i < numWorkers; ++i)
+	{
+		TUniquePtr<FMujocoSchedulerQueue> queue = MakeUnique<FMujocoSchedulerQueue>();
+		queue->WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+		Queues.Add(MoveTemp(queue));
+	}
+	for (int32 i = 0; i < numWorkers; ++i)
+	{
+		FMujocoSchedulerWorker *runnable = new FMujocoSchedulerWorker(this, i);
+		Runnables.Add(runnable);
+		Threads.Add(FRunnableThread::Create(runnable, *FString::Printf(TEXT("MujocoSchedulerWorker%d"), i)));
+	}
+}
+
+void UMujocoSimulationSubsystem::StopWorkers()
+{
+	bStopWorkers = true;
+	for (TUniquePtr<FMujocoSchedulerQueue> &queue : Queues)
+		queue->WakeEvent->Trigger();
+	for (FRunnableThread *thread : Threads)
+	{
+		thread->WaitForCompletion();
+		delete thread;
+	}
+	for (FMujocoSchedulerWorker *runnable : Runnables)
+		delete runnable;
+	for (TUniquePtr<FMujocoSchedulerQueue> &queue : Queues)
+	{
+		for (auto &simulation : queue->Simulations)
+			simulation->Stepper->EndStepping();
+		FPlatformProcess::ReturnSynchEventToPool(queue->WakeEvent);
+	}
+	Threads.Empty();
+	Runnables.Empty();
+	Queues.Empty();
+}
+
+void UMujocoSimulationSubsystem::RegisterSimulation(FMujocoWorkerThread *Stepper)
+{
+	if (!Stepper)
+		return;
+	if (Queues.Num() == 0)
+		StartWorkers();
+
+	// Home the simulation on the worker with the fewest simulations
+	int32 home = 0;
+	for (int32 i = 1; i < Queues.Num(); ++i)
+	{
+		if (Queues[i]->Simulations.Num() < Queues[home]->Simulations.Num())
+			home = i;
+	}
+
+	TSharedPtr<FMujocoScheduledSimulation, ESPMode::ThreadSafe> simulation = MakeShared<FMujocoScheduledSimulation, ESPMode::ThreadSafe>();
+	simulation->Stepper = Stepper;
+	simulation->HomeWorker = home;
+	simulation->NextDue = FPlatformTime::Seconds();
+	Stepper->BeginStepping();
+	{
+		FScopeLock lock(&Queues[home]->Lock);
+		Queues[home]->Simulations.Add(simulation);
+	}
+	Queues[home]->WakeEvent->Trigger();
+}
+
+void UMujocoSimulationSubsystem::UnregisterSimulation(FMujocoWorkerThread *Stepper)
+{
+	for (TUniquePtr<FMujocoSchedulerQueue> &queue : Queues)
+	{
+		TSharedPtr<FMujocoScheduledSimulation, ESPMode::ThreadSafe> removed;
+		{
+			FScopeLock lock(&queue->Lock);
+			int32 index = INDEX_NONE;
+			for (int32 i = 0; i < queue->Simulations.Num() && index == INDEX_NONE; ++i)
+			{
+				if (queue->Simulations[i]->Stepper == Stepper)
+					index = i;
+			}
+			if (index == INDEX_NONE)
+				continue;
+			removed = queue->Simulations[index];
+			queue->Simulations.RemoveAtSwap(index);
+		}
+		// A worker may have claimed it just before it was removed; wait for that run to finish
+		while (removed->bBusy.load(std::memory_order_acquire))
+			FPlatformProcess::SleepNoStats(0.0f);
+		Stepper->EndStepping();
+		return;
+	}
+}
+
+bool UMujocoSimulationSubsystem::GetSimulationStats(const FMujocoWorkerThread *Stepper, FMujocoSchedulerStats &OutStats) const
+{
+	for (const TUniquePtr<FMujocoSchedulerQueue> &queue : Queues)
+	{
+		FScopeLock lock(&queue->Lock);
+		for (const auto &simulation : queue->Simulations)
+		{
+			if (simulation->Stepper != Stepper)
+				continue;
+			OutStats.AverageLatencyMs = simulation->AverageLatencyMs.load(std::memory_order_relaxed);
+			OutStats.MaxLatencyMs = simulation->MaxLatencyMs.load(std::memory_order_relaxed);
+			OutStats.AverageRunMs = simulation->AverageRunMs.load(std::memory_order_relaxed);
+			OutStats.StepsPerSecond = simulation->StepsPerSecond.load(std::memory_order_relaxed);
+			OutStats.StolenRuns = simulation->StolenRuns.load(std::memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
+
+int32 UMujocoSimulationSubsystem::GetNumSimulations() const
+{
+	int32 count = 0;
+	for (const TUniquePtr<FMujocoSchedulerQueue> &queue : Queues)
+	{
+		FScopeLock lock(&queue->Lock);
+		count += queue->Simulations.Num();
+	}
+	return count;
+}
+
+void UMujocoSimulationSubsystem::RunWorker(int32 WorkerIndex)
+{
+	FMujocoSchedulerQueue &ownQueue = *Queues[WorkerIndex];
+	while (!bStopWorkers)
+	{
+		double earliestDue = TNumericLimits<double>::Max();
+		TSharedPtr<FMujocoScheduledSimulation, ESPMode::ThreadSafe> simulation = ClaimDueSimulation(WorkerIndex, FPlatformTime::Seconds(), earliestDue);
+		if (simulation)
+		{
+			RunSimulation(*simulation, WorkerIndex);
+			simulation->bBusy.store(false, std::memory_order_release);
+			continue;
+		}
+
+		const double wait = FMath::Min(earliestDue - FPlatformTime::Seconds(), MaxIdleWait);
+		if (wait > SpinThreshold)
+			ownQueue.WakeEvent->Wait(FMath::Max(1, (int32)((wait - SpinThreshold) * 1000)));
+		else
+			FPlatformProcess::SleepNoStats(0.0f);
+	}
+}
+
+TSharedPtr<FMujocoScheduledSimulation, ESPMode::ThreadSafe> UMujocoSimulationSubsystem::ClaimDueSimulation(int32 WorkerIndex, double Now, double &OutEarliestDue)
+{
+	// Own queue first, then every other queue starting with the next worker
+	for (int32 offset = 0; offset < Queues.Num(); ++offset)
+	{
+		FMujocoSchedulerQueue &queue = *Queues[(WorkerIndex + offset) % Queues.Num()];
+		FScopeLock lock(&queue.Lock);
+
+		TSharedPtr<FMujocoScheduledSimulation, ESPMode::ThreadSafe> best;
+		double bestDue = Now;
+		for (const auto &simulation : queue.Simulations)
+		{
+			if (simulation->bBusy.load(std::memory_order_relaxed))
+				continue;
+			const double due = simulation->NextDue.load(std::memory_order_relaxed);
+			OutEarliestDue = FMath::Min(OutEarliestDue, due);
+			if (due <= bestDue)
+			{
+				best = simulation;
+				bestDue = due;
+			}
+		}
+
+		bool expected = false;
+		if (best && best->bBusy.compare_exchange_strong(expected, true, std::memory_order_acquire))
+			return best;
+	}
+	return nullptr;
+}
+
+void UMujocoSimulationSubsystem::RunSimulation(FMujocoScheduledSimulation &Simulation, int32 WorkerIndex)
+{
+	const double start = FPlatformTime::Seconds();
+	const float latencyMs = (float)FMath::Max(start - Simulation.NextDue.load(std::memory_order_relaxed), 0.0) * 1000;
+
+	const double nextDue = Simulation.Stepper->Advance();
+
+	const double end = FPlatformTime::Seconds();
+	Simulation.NextDue.store(nextDue > 0 ? nextDue : end, std::memory_order_relaxed);
+
+	const float runMs = (float)(end - start) * 1000;
+	Simulation.AverageLatencyMs.store(FMath::Lerp(Simulation.AverageLatencyMs.load(std::memory_order_relaxed), latencyMs, StatsSmoothing), std::memory_order_relaxed);
+	Simulation.MaxLatencyMs.store(FMath::Max(Simulation.MaxLatencyMs.load(std::memory_order_relaxed), latencyMs), std::memory_order_relaxed);
+	Simulation.AverageRunMs.store(FMath::Lerp(Simulation.AverageRunMs.load(std::memory_order_relaxed), runMs, StatsSmoothing), std::memory_order_relaxed);
+	if (WorkerIndex != Simulation.HomeWorker)
+		Simulation.StolenRuns.fetch_add(1, std::memory_order_relaxed);
+
+	const int64 steps = Simulation.Stepper->GetTotalSteps();
+	if (Simulation.WindowStart == 0)
+	{
+		Simulation.WindowStart = end;
+		Simulation.WindowSteps = steps;
+	}
+	else if (end - Simulation.WindowStart >= ThroughputWindow)
+	{
+		Simulation.StepsPerSecond.store((float)((steps - Simulation.WindowSteps) / (end - Simulation.WindowStart)), std::memory_order_relaxed);
+		Simulation.WindowStart = end;
+		Simulation.WindowSteps = steps;
+	}
+}
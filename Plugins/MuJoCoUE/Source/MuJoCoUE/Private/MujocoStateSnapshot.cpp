@@ -0,0 +1,156 @@
+#include "MujocoStateSnapshot.h"
+
+#include "HAL/PlatformTime.h"
+
+void FMujocoStateSnapshot::Initialize(const mjModel *m, bool bWithPrevious)
+{
+	Time = 0;
+	StepIndex = 0;
+	PublishTime = 0;
+	PreviousTime = 0;
+	PublishIndex = 0;
+	BodyChangeIndex.SetNumZeroed(m->nbody);
+	BodyXPos.SetNumZeroed(m->nbody * 3);
+	BodyXQuat.SetNumZeroed(m->nbody * 4);
+	GeomXPos.SetNumZeroed(m->ngeom * 3);
+	GeomXMat.SetNumZeroed(m->ngeom * 9);
+
+	const int32 prevBodies = bWithPrevious ? m->nbody : 0;
+	const int32 prevGeoms = bWithPrevious ? m->ngeom : 0;
+	PrevBodyXPos.SetNumZeroed(prevBodies * 3);
+	PrevBodyXQuat.SetNumZeroed(prevBodies * 4);
+	PrevGeomXPos.SetNumZeroed(prevGeoms * 3);
+	PrevGeomXMat.SetNumZeroed(prevGeoms * 9);
+}
+
+void FMujocoStateSnapshot::CopyCurrentToPrevious()
+{
+	if (!HasPrevious())
+		return;
+	PreviousTime = Time;
+	PrevBodyXPos = BodyXPos;
+	PrevBodyXQuat = BodyXQuat;
+	PrevGeomXPos = GeomXPos;
+	PrevGeomXMat = GeomXMat;
+}
+
+void FMujocoStateSnapshot::CopyFrom(const mjData *d)
+{
+	Time = d->time;
+	FMemory::Memcpy(BodyXPos.GetData(), d->xpos, BodyXPos.Num() * sizeof(mjtNum));
+	FMemory::Memcpy(BodyXQuat.GetData(), d->xquat, BodyXQuat.Num() * sizeof(mjtNum));
+	FMemory::Memcpy(GeomXPos.GetData(), d->geom_xpos, GeomXPos.Num() * sizeof(mjtNum));
+	FMemory::Memcpy(GeomXMat.GetData(), d->geom_xmat, GeomXMat.Num() * sizeof(mjtNum));
+}
+
+FMujocoSnapshotBuffer::FMujocoSnapshotBuffer()
+	: Middle(1)
+	, WriteIndex(0)
+	, ReadIndex(2)
+	, bKeepPrevious(false)
+	, ChangeThreshold(0)
+	, PublishCount(0)
+{
+}
+
+void FMujocoSnapshotBuffer::Initialize(const mjModel *m, const mjData *d, bool bInKeepPrevious, double InChangeThreshold)
+{
+	bKeepPrevious = bInKeepPrevious;
+	ChangeThreshold = InChangeThreshold;
+	PublishCount = 0;
+	BodyChangeIndex.SetNumZeroed(m->nbody);
+	ReferenceXPos.SetNumZeroed(m->nbody * 3);
+	ReferenceXQuat.SetNumZeroed(m->nbody * 4);
+	if (d)
+	{
+		FMemory::Memcpy(ReferenceXPos.GetData(), d->xpos, ReferenceXPos.Num() * sizeof(mjtNum));
+		FMemory::Memcpy(ReferenceXQuat.GetData(), d->xquat, ReferenceXQuat.Num() * sizeof(mjtNum));
+	}
+	const double now = FPlatformTime::Seconds();
+	for (FMujocoStateSnapshot &Slot : Slots)
+	{
+		Slot.Initialize(m, bKeepPrevious);
+		if (d)
+			Slot.CopyFrom(d);
+		Slot.CopyCurrentToPrevious();
+		Slot.PublishTime = now;
+	}
+	Last.Initialize(m);
+	if (d)
+		Last.CopyFrom(d);
+	WriteIndex = 0;
+	ReadIndex = 2;
+	Middle.store(1, std::memory_order_release);
+}
+
+void FMujocoSnapshotBuffer::Publish()
+{
+	// Hand the freshly written slot to the middle and take whatever was there back for writing.
+	const uint32 Previous = Middle.exchange(WriteIndex | FreshBit, std::memory_order_acq_rel);
+	WriteIndex = Previous & IndexMask;
+}
+
+void FMujocoSnapshotBuffer::Publish(const mjData *d, uint64 StepIndex)
+{
+	FMujocoStateSnapshot &Snapshot = GetWriteSnapshot();
+	if (bKeepPrevious)
+	{
+		// Hand the last poses over without copying, then refill Last from d
+		Snapshot.PreviousTime = Last.Time;
+		Swap(Snapshot.PrevBodyXPos, Last.BodyXPos);
+		Swap(Snapshot.PrevBodyXQuat, Last.BodyXQuat);
+		Swap(Snapshot.PrevGeomXPos, Last.GeomXPos);
+		Swap(Snapshot.PrevGeomXMat, Last.GeomXMat);
+		Last.CopyFrom(d);
+	}
+	Snapshot.CopyFrom(d);
+	Snapshot.StepIndex = StepIndex;
+	++PublishCount;
+	DetectChanges(d);
+	Snapshot.PublishIndex = PublishCount;
+	FMemory::Memcpy(Snapshot.BodyChangeIndex.GetData(), BodyChangeIndex.GetData(), BodyChangeIndex.Num() * sizeof(uint64));
+	Snapshot.PublishTime = FPlatformTime::Seconds();
+	Publish();
+}
+
+void FMujocoSnapshotBuffer::DetectChanges(const mjData *d)
+{
+	// Compare against the pose at the last recorded change rather than the last step, so
+	// slow drift still gets recorded once it adds up to the threshold
+	const double positionThreshold = ChangeThreshold * ChangeThreshold;
+	// 1 - |q0.q1| is about angle^2 / 8 for small angles
+	const double rotationThreshold = ChangeThreshold * ChangeThreshold / 8;
+	const int32 count = BodyChangeIndex.Num();
+	for (int32 i = 0; i < count; ++i)
+	{
+		const mjtNum *p = d->xpos + 3 * i;
+		const mjtNum *q = d->xquat + 4 * i;
+		mjtNum *refP = &ReferenceXPos[3 * i];
+		mjtNum *refQ = &ReferenceXQuat[4 * i];
+		const double dx = p[0] - refP[0], dy = p[1] - refP[1], dz = p[2] - refP[2];
+		const double dot = q[0] * refQ[0] + q[1] * refQ[1] + q[2] * refQ[2] + q[3] * refQ[3];
+		const bool bMoved = ChangeThreshold > 0
+								? dx * dx + dy * dy + dz * dz > positionThreshold || 1 - FMath::Abs(dot) > rotationThreshold
+								: dx != 0 || dy != 0 || dz != 0 || q[0] != refQ[0] || q[1] != refQ[1] || q[2] != refQ[2] || q[3] != refQ[3];
+		if (!bMoved)
+			continue;
+		BodyChangeIndex[i] = PublishCount;
+		FMemory::Memcpy(refP, p, 3 * sizeof(mjtNum));
+		FMemory::Memcpy(refQ, q, 4 * sizeof(mjtNum));
+	}
+}
+
+const FMujocoStateSnapshot &FMujocoSnapshotBuffer::AcquireLatest()
+{
+	if (Middle.load(std::memory_order_relaxed) & FreshBit)
+	{
+		const uint32 Previous = Middle.exchange(ReadIndex, std::memory_order_acq_rel);
+		ReadIndex = Previous & IndexMask;
+	}
+	return Slots[ReadIndex];
+}
+
+bool FMujocoSnapshotBuffer::HasFreshSnapshot() const
+{
+	return (Middle.load(std::memory_order_relaxed) & FreshBit) != 0;
+}
@@ -3,42 +3,336 @@
 #include "HAL/RunnableThread.h"
 #include "HAL/ThreadSafeBool.h"
 #include "HAL/ThreadSafeCounter.h"
+#include "HAL/PlatformTime.h"
 #include "MujocoWorkerThread.h"
 #include "Misc/ScopeLock.h"
-#include <chrono>
 
 
-FMujocoWorkerThread::FMujocoWorkerThread(mjData& InSharedmData, mjModel& InSharedmModel, FThreadSafeBool& InStopCondition, FThreadSafeCounter& InRunCount)
+namespace
+{
+	// SlowClock 每次落后时把速率乘以这个系数, 追上后除以它恢复
+	constexpr float SlowClockStep = 0.8f;
+	// SlowClock 最多把速率降到请求值的这个比例, 再低就丢弃时间
+	constexpr float SlowClockFloor = 0.05f;
+	// 连续这么多次准时唤醒后才恢复一级, 避免刚降速就因为一次准时而撤销
+	constexpr int32 RecoverAfterOnTimeWakes = 16;
+	// 只有用掉的步数不超过预算的这个比例时才算有余量
+	constexpr float RecoverBudgetFraction = 0.5f;
+}
+
+FMujocoWorkerThread::FMujocoWorkerThread(mjData& InSharedmData, mjModel& InSharedmModel, FThreadSafeBool& InStopCondition, FThreadSafeCounter& InRunCount, FMujocoSnapshotBuffer& InSnapshots, FMujocoCommandQueue& InCommands, const FMujocoWorkerSettings& InSettings)
 	: SharedmData(&InSharedmData)
-	, SharedmModel(&InSharedmModel)
+	, SharedmModel(InSettings.LagPolicy == EMujocoLagPolicy::DegradeSolver ? mj_copyModel(nullptr, &InSharedmModel) : &InSharedmModel)
+	, bOwnsModel(InSettings.LagPolicy == EMujocoLagPolicy::DegradeSolver)
 	, StopCondition(InStopCondition)
 	, RunCount(InRunCount)
+	, Snapshots(InSnapshots)
+	, StepCount(0)
+	, Commands(InCommands)
+	, bPaused(false)
+	, PacingMode(InSettings.PacingMode)
+	, RealTimeFactor(InSettings.RealTimeFactor)
+	, MaxStepsPerWake(InSettings.MaxStepsPerWake)
+	, LagPolicy(InSettings.LagPolicy)
+	, MinSolverIterations(FMath::Max(InSettings.MinSolverIterations, 1))
+	, ModelSolverIterations(InSharedmModel.opt.iterations)
+	, WallStart(0)
+	, SimStart(0)
+	, RequestedFactor(InSettings.RealTimeFactor)
+	, EffectiveFactor(InSettings.RealTimeFactor)
+	, OnTimeWakes(0)
+	, StatTotalSteps(0)
+	, StatLaggedWakes(0)
+	, StatCurrentLag(0)
+	, StatMaxLag(0)
+	, StatDroppedTime(0)
+	, StatEffectiveFactor(InSettings.RealTimeFactor)
+	, StatSolverIterations(InSharedmModel.opt.iterations)
 {}
 
+FMujocoWorkerThread::~FMujocoWorkerThread()
+{
+	if (bOwnsModel && SharedmModel)
+		mj_deleteModel(SharedmModel);
+}
+
 // 工作线程运行函数
 uint32 FMujocoWorkerThread::Run()
 {
-    const double TargetInterval = 1.0 / 10.0; // 100Hz = 每10毫秒一次
-
-	double startTime = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+	BeginStepping();
     while (!StopCondition)
     {
-		if (!SharedmData || !SharedmModel)
+		const double nextDue = Advance();
+		WaitUntil(nextDue, PacingMode.load(std::memory_order_relaxed));
+	}
+	EndStepping();
+	return 0;
+}
+
+void FMujocoWorkerThread::BeginStepping()
+{
+	// 真实时间与仿真时间的对齐基准, 改变速率时重新对齐
+	Rebase(FPlatformTime::Seconds(), SharedmData ? SharedmData->time : 0, RealTimeFactor.load(std::memory_order_relaxed));
+	RequestedFactor = EffectiveFactor;
+	OnTimeWakes = 0;
+}
+
+void FMujocoWorkerThread::EndStepping()
+{
+	// 恢复模型原来的求解器设置
+	if (SharedmModel)
+		SharedmModel->opt.iterations = ModelSolverIterations;
+}
+
+double FMujocoWorkerThread::Advance()
+{
+    const double IdleInterval = 1.0 / 1000.0; // 模型未就绪或暂停时每1毫秒检查一次
+
+	if (!SharedmData || !SharedmModel)
+		return FPlatformTime::Seconds() + IdleInterval;
+
+	// 累加运行次数
+    RunCount.Increment();
+
+	ApplyCommands();
+	if (bPaused)
+		return FPlatformTime::Seconds() + IdleInterval;
+
+	const float factor = RealTimeFactor.load(std::memory_order_relaxed);
+	if (factor != RequestedFactor)
+	{
+		RequestedFactor = factor;
+		Rebase(FPlatformTime::Seconds(), SharedmData->time, factor);
+	}
+
+	// 尽可能快: 不做任何等待
+	if (EffectiveFactor <= 0)
+	{
+		mj_step(SharedmModel, SharedmData);
+		Snapshots.Publish(SharedmData, ++StepCount);
+		StatTotalSteps.store(StepCount, std::memory_order_relaxed);
+		return 0;
+	}
+
+	// 执行MuJoCo模拟步骤, 追上按速率缩放后的真实时间, 每次唤醒最多 MaxStepsPerWake 步
+	const double targetTime = SimStart + (FPlatformTime::Seconds() - WallStart) * EffectiveFactor;
+	int32 steps = 0;
+	while (SharedmData->time < targetTime && !StopCondition && (MaxStepsPerWake <= 0 || steps < MaxStepsPerWake))
+	{
+		// 命令只在两步之间执行; 重置或暂停后目标时间失效, 马上重新开始
+		if (steps > 0 && ApplyCommands())
+		{
+			StatTotalSteps.store(StepCount, std::memory_order_relaxed);
+			return 0;
+		}
+		// 进行MuJoCo模拟
+		mj_step(SharedmModel, SharedmData);
+		// 发布本步的完整快照, 游戏线程不会读到一半的位姿
+		Snapshots.Publish(SharedmData, ++StepCount);
+		++steps;
+	}
+	StatTotalSteps.store(StepCount, std::memory_order_relaxed);
+
+	const double now = FPlatformTime::Seconds();
+	const double lag = targetTime - SharedmData->time;
+	if (lag > 0 && MaxStepsPerWake > 0 && steps >= MaxStepsPerWake)
+		HandleLag(lag, now, targetTime);
+	else if (lag <= 0)
+		Recover(now, targetTime, steps);
+	else
+		OnTimeWakes = 0;
+
+	StatCurrentLag.store(FMath::Max(lag, 0.0), std::memory_order_relaxed);
+	if (lag > StatMaxLag.load(std::memory_order_relaxed))
+		StatMaxLag.store(lag, std::memory_order_relaxed);
+	StatEffectiveFactor.store(EffectiveFactor, std::memory_order_relaxed);
+	StatSolverIterations.store(SharedmModel->opt.iterations, std::memory_order_relaxed);
+
+	// 下一步在真实时间到达这里时才到期; 仍然落后时马上到期
+	return WallStart + (SharedmData->time - SimStart) / EffectiveFactor;
+}
+
+void FMujocoWorkerThread::StepFixed(int32 NumSteps)
+{
+	if (!SharedmData || !SharedmModel)
+		return;
+	RunCount.Increment();
+
+	ApplyCommands();
+	if (bPaused || NumSteps <= 0)
+		return;
+	for (int32 i = 0; i < NumSteps; ++i)
+		mj_step(SharedmModel, SharedmData);
+	StepCount += NumSteps;
+	StatTotalSteps.store(StepCount, std::memory_order_relaxed);
+	Snapshots.Publish(SharedmData, StepCount);
+}
+
+bool FMujocoWorkerThread::ApplyCommands()
+{
+	bool bClockChanged = false;
+	while (Commands.Dequeue(PendingCommand))
+	{
+		bClockChanged |= PendingCommand.Type != EMujocoCommandType::SetControls;
+		ApplyCommand(PendingCommand);
+	}
+	if (bClockChanged)
+		Rebase(FPlatformTime::Seconds(), SharedmData->time, RequestedFactor);
+	return bClockChanged;
+}
+
+void FMujocoWorkerThread::ApplyCommand(FMujocoCommand& Command)
+{
+	switch (Command.Type)
+	{
+	case EMujocoCommandType::SetControls:
+		// 整个控制向量一次写入, 不会出现一半新一半旧的控制量
+		if (Command.Data.Num() == SharedmModel->nu)
+			FMemory::Memcpy(SharedmData->ctrl, Command.Data.GetData(), SharedmModel->nu * sizeof(mjtNum));
+		break;
+	case EMujocoCommandType::Reset:
+		mj_resetData(SharedmModel, SharedmData);
+		PublishForward();
+		break;
+	case EMujocoCommandType::SetPaused:
+		bPaused = Command.bFlag;
+		break;
+	case EMujocoCommandType::Step:
+		mj_step(SharedmModel, SharedmData);
+		Snapshots.Publish(SharedmData, ++StepCount);
+		break;
+	case EMujocoCommandType::LoadKeyframe:
+		if (Command.Index >= 0 && Command.Index < SharedmModel->nkey)
 		{
-			FPlatformProcess::Sleep(TargetInterval); // Sleep for 1ms to avoid busy waiting
-			continue;
+			mj_resetDataKeyframe(SharedmModel, SharedmData, Command.Index);
+			PublishForward();
 		}
-		// 累加运行次数
-        RunCount.Increment();
-		// 执行MuJoCo模拟步骤
-		
-		double currentTime = (std::chrono::high_resolution_clock::now().time_since_epoch().count() - startTime) / 1e9; // Convert to seconds
-		while (SharedmData->time < currentTime)
-		{			// 进行MuJoCo模拟
-			mj_step(SharedmModel, SharedmData);
+		break;
+	case EMujocoCommandType::SetState:
+		if (Command.Data.Num() == SharedmModel->nq && Command.Data2.Num() == SharedmModel->nv)
+		{
+			FMemory::Memcpy(SharedmData->qpos, Command.Data.GetData(), SharedmModel->nq * sizeof(mjtNum));
+			FMemory::Memcpy(SharedmData->qvel, Command.Data2.GetData(), SharedmModel->nv * sizeof(mjtNum));
+			PublishForward();
 		}
+		break;
 	}
-	return 0;
+}
+
+void FMujocoWorkerThread::PublishForward()
+{
+	mj_forward(SharedmModel, SharedmData);
+	Snapshots.Publish(SharedmData, StepCount);
+}
+
+void FMujocoWorkerThread::Rebase(double Now, double SimTime, float Factor)
+{
+	WallStart = Now;
+	SimStart = SimTime;
+	EffectiveFactor = Factor;
+}
+
+void FMujocoWorkerThread::DropBacklog(double Lag, double Now)
+{
+	StatDroppedTime.store(StatDroppedTime.load(std::memory_order_relaxed) + Lag, std::memory_order_relaxed);
+	Rebase(Now, SharedmData->time, EffectiveFactor);
+}
+
+void FMujocoWorkerThread::HandleLag(double Lag, double Now, double TargetTime)
+{
+	StatLaggedWakes.fetch_add(1, std::memory_order_relaxed);
+	OnTimeWakes = 0;
+
+	switch (LagPolicy)
+	{
+	case EMujocoLagPolicy::DropTime:
+		DropBacklog(Lag, Now);
+		break;
+	case EMujocoLagPolicy::SlowClock:
+	{
+		// 保持目标时间连续, 只降低之后的速率, 落后量会随步进逐渐消化
+		const float slower = EffectiveFactor * SlowClockStep;
+		if (slower < RequestedFactor * SlowClockFloor)
+			DropBacklog(Lag, Now);
+		else
+			Rebase(Now, TargetTime, slower);
+		break;
+	}
+	case EMujocoLagPolicy::DegradeSolver:
+	{
+		const int32 iterations = SharedmModel->opt.iterations;
+		if (iterations > MinSolverIterations)
+			SharedmModel->opt.iterations = FMath::Max(iterations / 2, MinSolverIterations);
+		else
+			DropBacklog(Lag, Now);
+		break;
+	}
+	}
+}
+
+void FMujocoWorkerThread::Recover(double Now, double TargetTime, int32 Steps)
+{
+	if (EffectiveFactor >= RequestedFactor && SharedmModel->opt.iterations >= ModelSolverIterations)
+		return;
+	// 接近预算的唤醒虽然追上了, 但说明速度刚好够用, 不算有余量
+	if (MaxStepsPerWake > 0 && Steps > MaxStepsPerWake * RecoverBudgetFraction)
+	{
+		OnTimeWakes = 0;
+		return;
+	}
+	if (++OnTimeWakes < RecoverAfterOnTimeWakes)
+		return;
+	OnTimeWakes = 0;
+
+	if (EffectiveFactor < RequestedFactor)
+		Rebase(Now, TargetTime, FMath::Min(EffectiveFactor / SlowClockStep, RequestedFactor));
+	if (SharedmModel->opt.iterations < ModelSolverIterations)
+		SharedmModel->opt.iterations = FMath::Min(SharedmModel->opt.iterations * 2, ModelSolverIterations);
+}
+
+FMujocoLagStats FMujocoWorkerThread::GetLagStats() const
+{
+	FMujocoLagStats stats;
+	stats.TotalSteps = StatTotalSteps.load(std::memory_order_relaxed);
+	stats.LaggedWakes = StatLaggedWakes.load(std::memory_order_relaxed);
+	stats.CurrentLag = (float)StatCurrentLag.load(std::memory_order_relaxed);
+	stats.MaxLag = (float)StatMaxLag.load(std::memory_order_relaxed);
+	stats.DroppedTime = (float)StatDroppedTime.load(std::memory_order_relaxed);
+	stats.EffectiveRealTimeFactor = StatEffectiveFactor.load(std::memory_order_relaxed);
+	stats.SolverIterations = StatSolverIterations.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void FMujocoWorkerThread::WaitUntil(double WakeTime, EMujocoPacingMode Mode) const
+{
+	switch (Mode)
+	{
+	case EMujocoPacingMode::Sleep:
+	{
+		const double remaining = WakeTime - FPlatformTime::Seconds();
+		if (remaining > 0)
+			FPlatformProcess::SleepNoStats((float)remaining);
+		break;
+	}
+	case EMujocoPacingMode::Yield:
+		while (FPlatformTime::Seconds() < WakeTime && !StopCondition)
+			FPlatformProcess::SleepNoStats(0.0f);
+		break;
+	case EMujocoPacingMode::SpinWait:
+		while (FPlatformTime::Seconds() < WakeTime && !StopCondition)
+			FPlatformProcess::YieldCPU();
+		break;
+	}
+}
+
+void FMujocoWorkerThread::SetPacingMode(EMujocoPacingMode InMode)
+{
+	PacingMode.store(InMode, std::memory_order_relaxed);
+}
+
+void FMujocoWorkerThread::SetRealTimeFactor(float InRealTimeFactor)
+{
+	RealTimeFactor.store(InRealTimeFactor, std::memory_order_relaxed);
 }
 
 void FMujocoWorkerThread::Stop()
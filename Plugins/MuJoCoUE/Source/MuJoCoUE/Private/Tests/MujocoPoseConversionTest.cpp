@@ -0,0 +1,136 @@
+#include "MujocoPoseConversion.h"
+
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	/** Largest allowed angle between a converted rotation and MuJoCo's, in radians */
+	constexpr double MaxAngularError = 1e-6;
+
+	/** Appends the row-major matrix of rotation Angle about unit Axis, built by MuJoCo */
+	void AddRotation(TArray<mjtNum> &Matrices, const FVector &Axis, double Angle)
+	{
+		mjtNum quat[4];
+		const mjtNum axis[3] = {Axis.X, Axis.Y, Axis.Z};
+		mju_axisAngle2Quat(quat, axis, Angle);
+		const int32 offset = Matrices.AddUninitialized(9);
+		mju_quat2Mat(Matrices.GetData() + offset, quat);
+	}
+
+	/** Checks Count matrices against mju_mat2Quat through the vector kernel and the scalar reference */
+	void CheckMatrices(FAutomationTestBase &Test, const TCHAR *What, const TArray<mjtNum> &Matrices)
+	{
+		const int32 count = Matrices.Num() / 9;
+		TArray<FQuat> vectorResult, scalarResult;
+		vectorResult.SetNumUninitialized(count);
+		scalarResult.SetNumUninitialized(count);
+		MujocoPoseConversion::ConvertMatrices(Matrices.GetData(), vectorResult.GetData(), count);
+		MujocoPoseConversion::ConvertMatricesScalar(Matrices.GetData(), scalarResult.GetData(), count);
+
+		double maxVectorError = 0;
+		double maxScalarError = 0;
+		for (int32 i = 0; i < count; ++i)
+		{
+			mjtNum q[4];
+			mju_mat2Quat(q, Matrices.GetData() + 9 * i);
+			const FQuat expected(q[1], q[2], q[3], q[0]);
+			maxVectorError = FMath::Max(maxVectorError, expected.AngularDistance(vectorResult[i]));
+			maxScalarError = FMath::Max(maxScalarError, expected.AngularDistance(scalarResult[i]));
+			Test.TestTrue(FString::Printf(TEXT("%s: quaternion %d is normalized"), What, i), vectorResult[i].IsNormalized());
+		}
+		Test.TestTrue(FString::Printf(TEXT("%s: ConvertMatrices error %g rad"), What, maxVectorError), maxVectorError <= MaxAngularError);
+		Test.TestTrue(FString::Printf(TEXT("%s: ConvertMatricesScalar error %g rad"), What, maxScalarError), maxScalarError <= MaxAngularError);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMujocoPoseConversionMatricesTest, "MuJoCo.PoseConversion.ConvertMatrices",
+								 EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter)
+
+bool FMujocoPoseConversionMatricesTest::RunTest(const FString &Parameters)
+{
+	FRandomStream random(1234);
+
+	// Random rotations; 1003 leaves a scalar tail of 3 after the 4-wide batches
+	TArray<mjtNum> matrices;
+	for (int32 i = 0; i < 1003; ++i)
+		AddRotation(matrices, random.GetUnitVector(), random.FRandRange(-PI, PI));
+	CheckMatrices(*this, TEXT("Random"), matrices);
+
+	// Half turns have a trace of -1, so each lane must take one of the diagonal branches
+	matrices.Reset();
+	const FVector axes[] = {FVector::XAxisVector, FVector::YAxisVector, FVector::ZAxisVector,
+							FVector(1, 1, 0).GetSafeNormal(), FVector(0, 1, 1).GetSafeNormal(), FVector(1, 1, 1).GetSafeNormal(), FVector(-1, 2, 0.5).GetSafeNormal()};
+	for (const FVector &axis : axes)
+	{
+		AddRotation(matrices, axis, PI);
+		AddRotation(matrices, axis, PI - 1e-4);
+		AddRotation(matrices, axis, -PI + 1e-7);
+	}
+	CheckMatrices(*this, TEXT("Near 180 degrees"), matrices);
+
+	// Negative trace without being a half turn
+	matrices.Reset();
+	for (int32 i = 0; i < 101; ++i)
+		AddRotation(matrices, random.GetUnitVector(), random.FRandRange(2.2, PI));
+	CheckMatrices(*this, TEXT("Negative trace"), matrices);
+
+	// Counts below one batch only run the scalar tail
+	for (int32 count = 1; count < 4; ++count)
+	{
+		matrices.Reset();
+		for (int32 i = 0; i < count; ++i)
+			AddRotation(matrices, random.GetUnitVector(), random.FRandRange(-PI, PI));
+		CheckMatrices(*this, *FString::Printf(TEXT("Tail of %d"), count), matrices);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMujocoPoseConversionQuatsTest, "MuJoCo.PoseConversion.ConvertQuatsAndPositions",
+								 EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter)
+
+bool FMujocoPoseConversionQuatsTest::RunTest(const FString &Parameters)
+{
+	FRandomStream random(5678);
+	constexpr int32 count = 7;
+
+	TArray<mjtNum> quats;
+	TArray<mjtNum> positions;
+	for (int32 i = 0; i < count; ++i)
+	{
+		mjtNum quat[4];
+		const FVector axis = random.GetUnitVector();
+		const mjtNum mjAxis[3] = {axis.X, axis.Y, axis.Z};
+		mju_axisAngle2Quat(quat, mjAxis, random.FRandRange(-PI, PI));
+		quats.Append(quat, 4);
+		positions.Add(random.FRandRange(-10, 10));
+		positions.Add(random.FRandRange(-10, 10));
+		positions.Add(random.FRandRange(-10, 10));
+	}
+
+	TArray<FQuat> rotations;
+	rotations.SetNumUninitialized(count);
+	MujocoPoseConversion::ConvertQuats(quats.GetData(), rotations.GetData(), count);
+	TArray<FVector> converted;
+	converted.SetNumUninitialized(count);
+	MujocoPoseConversion::ConvertPositions(positions.GetData(), converted.GetData(), count);
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		// The same rotation as MuJoCo's matrix of that quaternion
+		mjtNum mat[9];
+		mju_quat2Mat(mat, &quats[4 * i]);
+		mjtNum expected[4];
+		mju_mat2Quat(expected, mat);
+		const double error = FQuat(expected[1], expected[2], expected[3], expected[0]).AngularDistance(rotations[i]);
+		TestTrue(FString::Printf(TEXT("ConvertQuats error %g rad at %d"), error, i), error <= MaxAngularError);
+
+		const FVector expectedPosition(positions[3 * i], positions[3 * i + 1], positions[3 * i + 2]);
+		TestEqual(FString::Printf(TEXT("ConvertPositions at %d"), i), converted[i], expectedPosition * MujocoPoseConversion::UnitsPerMeter);
+	}
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
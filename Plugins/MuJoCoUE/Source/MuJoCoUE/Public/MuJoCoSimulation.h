@@ -18,11 +18,22 @@
 #include "Components/StaticMeshComponent.h"
 
 #include "MujocoWorkerThread.h"
+#include "MujocoStateSnapshot.h"
+#include "MujocoPoseBuffer.h"
+#include "MujocoModelComponent.h"
+#include "MujocoMeshConversion.h"
+#include "MujocoCommandQueue.h"
+#include "MujocoTypes.h"
 #include "GameFramework/Actor.h"
 #include "ProceduralMeshComponent.h"
-// #include "Components/InstancedStaticMeshComponent.h"
+#include "Tasks/Task.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include <atomic>
 #include "MuJoCoSimulation.generated.h"
 
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FMujocoMeshConversionProgress, int32, Converted, int32, Total);
+
 /**
  * @struct BodyInfo
  * @brief Contains information about a body extracted form the MuJoCo Model and Data.
@@ -186,18 +197,89 @@ protected:
 	mjModel *mModel;
 	ModelInfo _info;
 	ModelInfo _infoStart;
+
+	/** @brief Body scene components indexed by MuJoCo body id; nullptr where none was created */
+	UPROPERTY(Transient)
+	TArray<USceneComponent *> BodyComponents;
+
+	/** @brief Geom mesh components indexed by MuJoCo geom id; nullptr where none was created */
+	UPROPERTY(Transient)
+	TArray<UStaticMeshComponent *> GeomComponents;
+
+	/** @brief Per geom: non-zero if its transform may be updated this frame (culling result) */
+	TArray<uint8> GeomVisible;
+
+	/** @brief Returns true if the geom's group is in VisibleGeomGroups */
+	bool IsGeomGroupVisible(int GeomId) const;
+
+	/**
+	 * @brief Culls the view update against the first local player's camera
+	 * @return false if the whole model is out of view; otherwise GeomVisible is filled
+	 */
+	bool ComputeVisibility(const FMujocoPoseBuffer &Poses);
+
+	/** @brief Per-frame body and geom poses; _info only holds the static model data */
+	FMujocoPoseBuffer PoseBuffer;
+
+	/** @brief Root transform the poses were last placed against */
+	FTransform LastRootTransform;
+
+	/** @brief PublishIndex of the snapshot last applied to PoseBuffer; MAX_uint64 before the first one */
+	uint64 LastAppliedPublishIndex = MAX_uint64;
+
+	/** @brief Fraction of geoms that needed a new transform in the last view update */
+	float DirtyFraction = 0;
 	bool bSimulationRunning = true;
 
 	// 工作线程相关变量
 	FThreadSafeBool bStopThread;
-    FRunnableThread* WorkerThread;
-    FMujocoWorkerThread* WorkerRunnable;
+    FRunnableThread* WorkerThread = nullptr;
+    FMujocoWorkerThread* WorkerRunnable = nullptr;
     FThreadSafeCounter ThreadRunCount;
 
+	/** @brief Pose snapshots published by the worker after every step and read lock-free in Tick */
+	FMujocoSnapshotBuffer SnapshotBuffer;
+
+	/** @brief Game-thread requests (controls, reset, pause, ...) applied by the worker between steps */
+	FMujocoCommandQueue CommandQueue;
+
+	/** @brief Control vector accumulated by SetControl and sent as one command per Tick */
+	TArray<mjtNum> PendingControls;
+	bool bControlsDirty = false;
+
+	/** @brief Lockstep mode: frame time not yet covered by a whole physics step, carried to the next Tick */
+	double LockstepRemainder = 0.0;
+
+	/**
+	 * @brief Queues a command for the worker thread without blocking
+	 * @return false if no worker is running or the queue is full
+	 */
+	bool SendCommand(FMujocoCommand &&Command);
+
+	/** @brief Sends PendingControls if SetControl changed it since the last Tick */
+	void FlushControls();
+
+	/** @brief Task simulating the next frame in Pipelined mode, joined at the start of the next Tick */
+	UE::Tasks::FTask PipelineTask;
+
+	/** @brief Number of mj_step calls that cover FixedDeltaTime */
+	int32 GetStepsPerFixedFrame() const;
+
+	/** @brief Pipelined mode: joins the running frame, shows it and starts simulating the next one */
+	void TickPipelined();
+
+	/** @brief MuJoCo thread pool bound to mData, created in BeginPlay when bUseThreadPool is set */
+	mjThreadPool *ThreadPool = nullptr;
+
+	/** @brief Resolves ThreadPoolWorkers to the number of pool threads to create */
+	int32 GetThreadPoolWorkerCount() const;
+
 public:
+	/** @brief Body components by MuJoCo id, filled once when the components are generated (runtime code uses BodyComponents) */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MuJoCo")
 	TMap<int, USceneComponent *> BodyMap;
 
+	/** @brief Geom components by MuJoCo id, filled once when the components are generated (runtime code uses GeomComponents) */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MuJoCo")
 	TMap<int, UStaticMeshComponent *> GeomMap1;
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MuJoCo")
@@ -214,13 +296,182 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MuJoCo")
 	UStaticMesh *defaultMesh;
 
+	/** @brief How geoms are rendered; set before BeginPlay */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MuJoCo|Rendering")
+	EMujocoGeomRenderMode GeomRenderMode = EMujocoGeomRenderMode::StaticMeshComponents;
+
+	/**
+	 * @brief Material for InstancedMeshes mode that reads its base color from PerInstanceCustomData 0..3
+	 * If unset, each group uses the material of its mesh and geom colors are not shown.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MuJoCo|Rendering", meta = (EditCondition = "GeomRenderMode == EMujocoGeomRenderMode::InstancedMeshes"))
+	UMaterialInterface *InstancedMaterial = nullptr;
+
+	/**
+	 * @brief Material for StaticMeshComponents mode that reads its base color from custom primitive data 0..3
+	 * If set, every geom component uses it directly and its color goes into the component's custom
+	 * primitive data. If unset, geoms of the same material and color share one material instance.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MuJoCo|Rendering", meta = (EditCondition = "GeomRenderMode == EMujocoGeomRenderMode::StaticMeshComponents"))
+	UMaterialInterface *PrimitiveColorMaterial = nullptr;
+
+	/**
+	 * @brief Apply body and geom poses in one bulk pass instead of per-component SetWorldLocation/SetWorldRotation
+	 *
+	 * All world transforms are computed into contiguous arrays first, then each component gets its
+	 * transform written directly and a single UpdateComponentToWorld. Components use absolute
+	 * location, rotation and scale so no update walks down the attachment hierarchy. Set before BeginPlay.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MuJoCo|Rendering")
+	bool bBatchTransformUpdates = true;
+
+	/**
+	 * @brief Flat component layout: attach every geom directly to the actor root
+	 *
+	 * Geoms get their world transforms from geom_xpos/geom_xmat instead of inheriting them
+	 * from a chain of body components, so moving one body no longer re-propagates through its
+	 * subtree. Body scene components are only created when bCreateBodyComponents is set.
+	 * Set before BeginPlay.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MuJoCo|Rendering")
+	bool bFlatComponentLayout = false;
+
+	/** @brief Flat layout: still create one scene component per body (e.g. to attach gameplay objects to) */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MuJoCo|Rendering", meta = (EditCondition = "bFlatComponentLayout"))
+	bool bCreateBodyComponents = false;
+
+	/** @brief One instanced component per (mesh, material) pair in InstancedMeshes mode */
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "MuJoCo|Rendering")
+	TArray<UInstancedStaticMeshComponent *> InstancedGeomGroups;
+
+	/** @brief Component drawing every geom in SingleProxy mode */
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "MuJoCo|Rendering")
+	UMujocoModelComponent *ModelComponent = nullptr;
+
+	/**
+	 * @brief Motion below which a body counts as at rest, in metres and radians. 0 counts any change
+	 *
+	 * The worker compares every body against its pose at its last recorded change; only
+	 * bodies that moved further (and their geoms) get their transforms updated.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MuJoCo|Rendering", meta = (ClampMin = "0.0"))
+	float RestThreshold = 1e-5f;
+
+	/**
+	 * @brief Stop pushing transforms for geoms outside the view frustum or beyond CullDistance
+	 *
+	 * Culled geoms keep simulating; their pending updates are applied once they are in view
+	 * again. When the whole model is out of view no transform is touched at all.
+	 * Applies to the batched component path and to instanced geoms. Has no effect with
+	 * GeomRenderMode == SingleProxy, which sends every moved geom to its proxy.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MuJoCo|Culling")
+	bool bCullUpdates = false;
+
+	/** @brief Distance from the camera (cm) beyond which updates are culled. 0 disables distance culling */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MuJoCo|Culling", meta = (ClampMin = "0.0", EditCondition = "bCullUpdates"))
+	float CullDistance = 0.0f;
+
+	/**
+	 * @brief Bit mask of the MuJoCo geom groups (geom_group 0..5) to show
+	 * Geoms of other groups, e.g. collision-only geoms, get no component and no updates. Set before BeginPlay.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MuJoCo|Culling")
+	int32 VisibleGeomGroups = 0x3F;
+
+	/** @brief Whether this actor gets its own worker thread or shares the world's scheduler pool */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MuJoCo|Threading")
+	EMujocoStepMode StepMode = EMujocoStepMode::DedicatedThread;
+
+	/** @brief Simulated seconds advanced per frame in Pipelined mode, and in Lockstep mode with bOverrideDeltaTime */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MuJoCo|Threading", meta = (ClampMin = "0.0001"))
+	float FixedDeltaTime = 1.0f / 60.0f;
+
+	/** @brief Lockstep mode: advance FixedDeltaTime per Tick instead of the frame's DeltaTime */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MuJoCo|Threading")
+	bool bOverrideDeltaTime = false;
+
+	/** @brief Lockstep mode: most substeps run in one Tick, the time beyond it is dropped. 0 disables the cap */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MuJoCo|Threading", meta = (ClampMin = "0"))
+	int32 MaxSubstepsPerTick = 0;
+
+	/** @brief How the worker thread waits until the next step is due (DedicatedThread mode only) */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MuJoCo|Threading")
+	EMujocoPacingMode PacingMode = EMujocoPacingMode::Sleep;
+
+	/** @brief Simulated seconds per wall-clock second (0.5, 1, 4, ...). 0 runs as fast as possible */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MuJoCo|Threading", meta = (ClampMin = "0.0"))
+	float RealTimeFactor = 1.0f;
+
+	/** @brief Upper bound on steps taken per worker wake-up. 0 disables the bound */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MuJoCo|Threading", meta = (ClampMin = "0"))
+	int32 MaxStepsPerWake = 100;
+
+	/** @brief What the worker does when MaxStepsPerWake is not enough to catch up */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MuJoCo|Threading")
+	EMujocoLagPolicy LagPolicy = EMujocoLagPolicy::DropTime;
+
+	/** @brief Lowest solver iteration count the DegradeSolver policy may use */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MuJoCo|Threading", meta = (ClampMin = "1", EditCondition = "LagPolicy == EMujocoLagPolicy::DegradeSolver"))
+	int32 MinSolverIterations = 4;
+
+	/**
+	 * @brief Interpolate rendered poses between the last two physics steps
+	 *
+	 * Positions are lerped and orientations slerped at render time, so the model can be
+	 * stepped at a lower rate than the frame rate without visible stutter. Adds up to one
+	 * physics step of display latency.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MuJoCo|Rendering")
+	bool bInterpolatePoses = false;
+
+	/**
+	 * @brief Convert MuJoCo meshes in the background instead of during BeginPlay
+	 *
+	 * The simulation starts right away; the mesh data is converted on task graph workers and
+	 * the components are created on the game thread once all meshes are done. Until then no
+	 * body or geom components exist. Either way the meshes are converted in parallel.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MuJoCo|Rendering")
+	bool bAsyncMeshConversion = false;
+
+	/**
+	 * @brief Build static meshes straight from the model's mesh arrays
+	 *
+	 * Skips the hidden UProceduralMeshComponent per MuJoCo mesh (and its collision) that the
+	 * static meshes were otherwise copied from; ProceduralMeshes stays empty. The mesh
+	 * descriptions are freed once the geoms are generated. Set before BeginPlay.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MuJoCo|Rendering")
+	bool bBuildMeshesDirectly = true;
+
+	/**
+	 * @brief Keep the converted meshes of each model on disk (Saved/MuJoCo/MeshCache) and reuse them
+	 * Later loads of a model with the same mesh data skip conversion and tangent generation.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MuJoCo|Rendering", meta = (EditCondition = "bBuildMeshesDirectly"))
+	bool bUseMeshDiskCache = true;
+
+	/** @brief Reports meshes converted so far on the game thread; the last call has Converted == Total */
+	UPROPERTY(BlueprintAssignable, Category = "MuJoCo|Rendering")
+	FMujocoMeshConversionProgress OnMeshConversionProgress;
+
+	/** @brief Let mj_step use a MuJoCo thread pool (mju_threadPoolCreate) for island-parallel work */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MuJoCo|Threading")
+	bool bUseThreadPool = false;
+
+	/** @brief Number of MuJoCo pool threads. 0 uses the number of cores minus one */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MuJoCo|Threading", meta = (ClampMin = "0", ClampMax = "128", EditCondition = "bUseThreadPool"))
+	int32 ThreadPoolWorkers = 0;
+
 protected:
 	virtual void BeginPlay() override;
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	/**
 	 * Simulate MuJoCo physics for a given time step.
-	 * Advances the MuJoCo physics simulation by the specified delta time.
+	 * In Lockstep mode advances the MuJoCo physics simulation by the specified delta time
+	 * on the calling thread; in every mode shows the newest published state.
 	 *
 	 * @param DeltaTime The time step in seconds to advance the simulation
 	 */
@@ -229,25 +480,54 @@ protected:
 	/**
 	 * @brief Extracts current state information from the MuJoCo simulation
 	 *
-	 * This function populates the provided ModelInfo structure with the current
-	 * body and geometry data from the active MuJoCo simulation, including positions,
-	 * orientations, and other relevant properties.
+	 * This function converts the current body and geometry poses of the active MuJoCo
+	 * simulation into the structure-of-arrays pose buffer, marking what moved as dirty.
 	 *
-	 * @param modelInfo Reference to a ModelInfo structure to be filled with current simulation state
+	 * The data is read from the newest snapshot published by the worker thread, never
+	 * from the mjData the worker is stepping, so all poses come from the same step.
+	 * With bInterpolatePoses the poses are blended between the snapshot's previous and
+	 * current step according to the wall-clock time elapsed since it was published
+	 * (not in the Lockstep and Pipelined modes, which always show the newest step).
+	 *
+	 * @param Poses Pose buffer to be filled with the current simulation state
+	 */
+	void ExtractCurrentState(FMujocoPoseBuffer &Poses);
+
+	/**
+	 * @brief Returns how far rendering is between the previous (0) and current (1) step of a snapshot
 	 */
-	void ExtractCurrentState(ModelInfo &modelInfo);
+	double GetInterpolationAlpha(const FMujocoStateSnapshot &Snapshot) const;
+
+	/** @brief Converted poses of a snapshot's previous (0) and current (1) step, blended by ExtractCurrentState */
+	TArray<FVector> InterpolationPositions[2];
+	TArray<FQuat> InterpolationRotations[2];
 
 	/**
 	 * @brief Updates the visual representation to match the current simulation state
 	 *
-	 * This function takes the current model info containing body and geometry data from
-	 * the MuJoCo simulation and updates the corresponding Unreal Engine components to
-	 * reflect the current state. It updates positions, rotations, and other visual properties
-	 * of bodies and geometries in the scene.
+	 * This function takes the current body and geometry poses of the MuJoCo simulation and
+	 * updates the corresponding Unreal Engine components to reflect the current state. Only
+	 * poses flagged dirty are applied (all of them if the actor moved); the flags are cleared.
 	 *
-	 * @param Info Reference to a ModelInfo structure containing the current simulation state
+	 * @param Poses Pose buffer containing the current simulation state
 	 */
-	void UpdateSimulationView(const ModelInfo &Info);
+	void UpdateSimulationView(FMujocoPoseBuffer &Poses);
+
+	/** @brief InstancedMeshes mode: writes all geom instance transforms, one batch update per group */
+	void UpdateInstancedGeoms(const FMujocoPoseBuffer &Poses);
+
+	/** @brief Original update path: SetWorldLocation/SetWorldRotation on every body and geom component */
+	void UpdateComponentsPerCall(const FMujocoPoseBuffer &Poses);
+
+	/** @brief Fills BodyWorldTransforms and GeomWorldTransforms for the dirty poses */
+	void ComputeWorldTransforms(const FMujocoPoseBuffer &Poses);
+
+	/** @brief Writes the dirty BodyWorldTransforms and GeomWorldTransforms to the components, one transform update each */
+	void CommitWorldTransforms(const FMujocoPoseBuffer &Poses);
+
+	/** @brief Per body / per geom world transforms of the current frame, indexed by MuJoCo id */
+	TArray<FTransform> BodyWorldTransforms;
+	TArray<FTransform> GeomWorldTransforms;
 
 	/**
 	 * @brief Generates mesh components for all geometries in the model
@@ -260,6 +540,56 @@ protected:
 	 */
 	void GenerateMeshes(ModelInfo &modelInfo);
 
+	/**
+	 * @brief Returns the static mesh used to draw a geom
+	 *
+	 * Uses MeshAssets for primitive types and builds a static mesh from the converted
+	 * procedural mesh for mjGEOM_MESH geoms (resetting the geom scale to 1 in that case).
+	 * Falls back to defaultMesh.
+	 *
+	 * @param GeomId MuJoCo id of the geom
+	 * @param geomInfo Geom information; its size may be adjusted
+	 */
+	UStaticMesh *GetGeomMesh(int GeomId, GeomInfo &geomInfo);
+
+	/**
+	 * @brief Returns the static mesh of MuJoCo mesh MeshId, building it on first use
+	 *
+	 * Meshes are cached by id for this simulation and by content hash in the world's
+	 * UMujocoSimulationSubsystem, so every geom and every simulation sharing a mesh
+	 * uses a single UStaticMesh.
+	 */
+	UStaticMesh *GetSharedMesh(int MeshId);
+
+	/** @brief Builds the static mesh of MuJoCo mesh MeshId from MeshDescriptions or ProceduralMeshes; null without data */
+	UStaticMesh *BuildStaticMesh(int MeshId, UObject *Outer);
+
+	/** @brief Static mesh per MuJoCo mesh id, null until first used */
+	UPROPERTY(Transient)
+	TArray<UStaticMesh *> MeshCache;
+
+	/**
+	 * @brief Creates the instanced components of InstancedMeshes mode, one per (mesh, material) pair
+	 */
+	void GenerateInstancedGeoms(ModelInfo &modelInfo);
+
+	/**
+	 * @brief Creates the UMujocoModelComponent of SingleProxy mode, holding every visible geom
+	 */
+	void GenerateModelComponent(ModelInfo &modelInfo);
+
+	/** @brief Per geom: index into InstancedGeomGroups (X) and instance index in that group (Y) */
+	TArray<FIntPoint> GeomInstances;
+
+	/** @brief Per instanced group: transforms of all its instances, of which the moved range is committed each frame */
+	TArray<TArray<FTransform>> InstancedGroupTransforms;
+
+	/** @brief Per instanced group: which of its instances moved this frame */
+	TArray<TBitArray<>> InstancedGroupDirty;
+
+	/** @brief Scratch copy of the moved range of one group, handed to BatchUpdateInstancesTransforms */
+	TArray<FTransform> InstancedRunTransforms;
+
 	/**
 	 * @brief Converts custom MuJoCo mesh geometries to procedural meshes in Unreal Engine
 	 *
@@ -268,19 +598,70 @@ protected:
 	 * It reads vertex positions, normals, face indices, and other mesh properties from the MuJoCo model
 	 * and creates equivalent mesh representations that can be rendered in the Unreal Engine scene.
 	 *
+	 * The mesh data is converted in parallel (MujocoMeshConversion::ConvertMeshes); only the
+	 * components are created on the game thread. ProceduralMeshes is indexed by mesh id, with
+	 * null entries for empty meshes.
+	 *
 	 * @param mjModel Pointer to the MuJoCo model containing the mesh data to extract
 	 * @param  UObject* Outer Reference to owner of the procedural mesh components
 	 */
 	void ConvertMuJoCoModelToProceduralMeshes(const mjModel *mjModel, UObject *Outer);
 
+	/** @brief Creates one procedural mesh component per entry of ConvertedMeshes, then frees them */
+	void CreateProceduralMeshes(UObject *Outer);
+
+	/** @brief Converts every mesh on the calling thread and its helpers, the way bBuildMeshesDirectly asks for */
+	void ConvertModelMeshes();
+
+	/** @brief Generates the geoms from the converted meshes, frees the conversion data and logs the memory used */
+	void FinishModelMeshes();
+
+	/** @brief Direct path: mesh description per mesh id, freed by FinishModelMeshes */
+	TArray<FMeshDescription> MeshDescriptions;
+
+	/** @brief Process memory in use when mesh conversion started, for the log of FinishModelMeshes */
+	uint64 MeshMemoryBaseline = 0;
+
+	/** @brief bAsyncMeshConversion: starts converting every mesh of mModel on the task graph */
+	void StartMeshConversion();
+
+	/** @brief bAsyncMeshConversion: reports progress and, once converted, creates the components */
+	void PollMeshConversion();
+
+	/** @brief Converted mesh data waiting for its components, indexed by mesh id */
+	TArray<FMujocoConvertedMesh> ConvertedMeshes;
+
+	/** @brief Background conversion started by StartMeshConversion; invalid when none is running */
+	UE::Tasks::FTask MeshConversionTask;
+
+	/** @brief Meshes converted by MeshConversionTask so far, and the count last reported */
+	std::atomic<int32> ConvertedMeshCount{0};
+	int32 ReportedMeshCount = 0;
+
 	/**
 	 * Sets the color of a static mesh component.
 	 *
+	 * Uses PrimitiveColorMaterial with the color in custom primitive data when set, otherwise
+	 * the shared instance of the component's material for that color (GetColorMaterial).
+	 *
 	 * @param StaticMeshComponent The static mesh component to update
 	 * @param Color The new linear color to apply to the mesh
 	 */
 	void SetMeshColor(UStaticMeshComponent *StaticMeshComponent, FLinearColor Color);
 
+	/**
+	 * @brief Returns the material instance of BaseMaterial with BaseColor set to Color
+	 * One instance is created per (material, color) pair and shared by every geom using it.
+	 */
+	UMaterialInterface *GetColorMaterial(UMaterialInterface *BaseMaterial, const FLinearColor &Color);
+
+	/** @brief Material instances created by GetColorMaterial, by base material and color */
+	TMap<TPair<UMaterialInterface *, FLinearColor>, UMaterialInstanceDynamic *> ColorMaterialLookup;
+
+	/** @brief Keeps the instances in ColorMaterialLookup alive */
+	UPROPERTY(Transient)
+	TArray<UMaterialInstanceDynamic *> ColorMaterials;
+
 	/**
 	 * used for Debugging toprintout some properties
 	 **/
@@ -307,4 +688,81 @@ public:
 
 	UFUNCTION(BlueprintCallable, Category = "MuJoCo")
 	void SetControl(int Id, float Value);
+
+	/** @brief Scene component of body Id, or nullptr if there is none */
+	UFUNCTION(BlueprintPure, Category = "MuJoCo")
+	USceneComponent *GetBodyComponent(int32 Id) const { return BodyComponents.IsValidIndex(Id) ? BodyComponents[Id] : nullptr; }
+
+	/** @brief Mesh component of geom Id, or nullptr if there is none */
+	UFUNCTION(BlueprintPure, Category = "MuJoCo")
+	UStaticMeshComponent *GetGeomComponent(int32 Id) const { return GeomComponents.IsValidIndex(Id) ? GeomComponents[Id] : nullptr; }
+
+	/** @brief Replaces the whole control vector; applied by the worker in one piece */
+	UFUNCTION(BlueprintCallable, Category = "MuJoCo")
+	void SetControls(const TArray<float> &Values);
+
+	/** @brief Resets the simulation to keyframe Key of the model */
+	UFUNCTION(BlueprintCallable, Category = "MuJoCo")
+	void LoadKeyframe(int32 Key);
+
+	/** @brief Overwrites qpos and qvel; sizes must match nq and nv of the model */
+	UFUNCTION(BlueprintCallable, Category = "MuJoCo")
+	void SetState(const TArray<float> &QPos, const TArray<float> &QVel);
+
+	UFUNCTION(BlueprintCallable, Category = "MuJoCo|Threading")
+	void SetPacingMode(EMujocoPacingMode Mode);
+
+	UFUNCTION(BlueprintCallable, Category = "MuJoCo|Threading")
+	void SetRealTimeFactor(float Factor);
+
+	/** @brief Returns how well the worker thread keeps up with wall-clock time */
+	UFUNCTION(BlueprintPure, Category = "MuJoCo|Threading")
+	FMujocoLagStats GetLagStats() const;
+
+	/** @brief Returns the fraction of geoms whose transforms were updated in the last frame */
+	UFUNCTION(BlueprintPure, Category = "MuJoCo|Rendering")
+	float GetDirtyFraction() const { return DirtyFraction; }
+
+	/** @brief Returns scheduling latency and throughput when running in SharedScheduler mode */
+	UFUNCTION(BlueprintPure, Category = "MuJoCo|Threading")
+	FMujocoSchedulerStats GetSchedulerStats() const;
+
+	/**
+	 * @brief Times Steps steps of the loaded model single-threaded and with a thread pool
+	 *
+	 * Runs on scratch mjData instances so the running simulation is not disturbed, logs
+	 * both timings and returns the speed-up of the pooled run (single time / pooled time).
+	 *
+	 * @param Steps Number of mj_step calls for each run
+	 * @return Speed-up factor, or 0 if no model is loaded
+	 */
+	UFUNCTION(BlueprintCallable, Category = "MuJoCo|Threading")
+	float BenchmarkThreadPool(int32 Steps = 1000);
+
+	/**
+	 * @brief Times the per-component and the batched transform update paths on the current pose
+	 *
+	 * Runs each path Iterations times on the components of this actor, logs the cost per
+	 * update and returns the speed-up of the batched path (per-component time / batched time).
+	 * The per-component path is measured on the components as they are set up, so run it once
+	 * with bBatchTransformUpdates off to compare against the original attached hierarchy.
+	 *
+	 * @param Iterations Number of full updates timed for each path
+	 * @return Speed-up factor, or 0 if there are no components to update
+	 */
+	UFUNCTION(BlueprintCallable, Category = "MuJoCo|Rendering")
+	float BenchmarkTransformUpdate(int32 Iterations = 100);
+
+	/**
+	 * @brief Checks and times the batch geom_xmat to quaternion conversion on the current pose
+	 *
+	 * Converts the newest snapshot's geom matrices with mju_mat2Quat, the scalar kernel and
+	 * the vectorized kernel, logs the time per frame of each and the largest angle between
+	 * a kernel result and mju_mat2Quat, and returns the speed-up of the vectorized kernel.
+	 *
+	 * @param Iterations Number of conversions of all geoms timed for each path
+	 * @return Speed-up factor over mju_mat2Quat, or 0 if no model is loaded
+	 */
+	UFUNCTION(BlueprintCallable, Category = "MuJoCo|Rendering")
+	float BenchmarkPoseConversion(int32 Iterations = 1000);
 };
@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "mujoco/mujoco.h"
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "MujocoBatchSimulation.generated.h"
+
+/**
+ * @class UMujocoBatchSimulation
+ * @brief Headless batch of N mjData instances sharing one mjModel, for parallel rollouts.
+ *
+ * The batch creates no components and needs no world: it only owns the model and the
+ * data instances. StepAll advances every instance across the task graph workers with
+ * ParallelFor, and GetObservations packs qpos, qvel and sensordata of all instances
+ * into one contiguous buffer laid out instance after instance.
+ *
+ * Calls are not thread safe with respect to each other; use one batch from one thread.
+ */
+UCLASS(BlueprintType)
+class MUJOCOUE_API UMujocoBatchSimulation : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual void BeginDestroy() override;
+
+	/**
+	 * @brief Loads the model and creates NumInstances data instances
+	 *
+	 * @param Xml Path of the MuJoCo XML file, relative to the project content directory
+	 * @param NumInstances Number of mjData instances to create
+	 * @return true if the model was loaded and every instance was created
+	 */
+	UFUNCTION(BlueprintCallable, Category = "MuJoCo|Batch")
+	bool Initialize(FString Xml, int32 NumInstances);
+
+	/** @brief Frees the model and every data instance */
+	UFUNCTION(BlueprintCallable, Category = "MuJoCo|Batch")
+	void Release();
+
+	/** @brief Advances every instance by NumSteps mj_step calls in parallel */
+	UFUNCTION(BlueprintCallable, Category = "MuJoCo|Batch")
+	void StepAll(int32 NumSteps = 1);
+
+	/** @brief Resets the listed instances to the model's initial state (or keyframe Key if >= 0); repeated and invalid indices are ignored */
+	UFUNCTION(BlueprintCallable, Category = "MuJoCo|Batch")
+	void ResetInstances(const TArray<int32> &Instances, int32 Key = -1);
+
+	/**
+	 * @brief Writes the controls of all instances from one contiguous buffer
+	 * @param Controls NumInstances x nu values, instance after instance
+	 */
+	UFUNCTION(BlueprintCallable, Category = "MuJoCo|Batch")
+	void SetControls(const TArray<float> &Controls);
+
+	/**
+	 * @brief Packs the observations of all instances into one contiguous buffer
+	 * @param OutObservations Resized to NumInstances x GetObservationSize(), instance after instance
+	 */
+	UFUNCTION(BlueprintCallable, Category = "MuJoCo|Batch")
+	void GetObservations(TArray<float> &OutObservations) const;
+
+	/** @brief Number of values per instance in GetObservations: nq + nv + nsensordata */
+	UFUNCTION(BlueprintPure, Category = "MuJoCo|Batch")
+	int32 GetObservationSize() const;
+
+	UFUNCTION(BlueprintPure, Category = "MuJoCo|Batch")
+	int32 GetNumInstances() const { return Datas.Num(); }
+
+	/** @brief Shared model, or nullptr before Initialize */
+	const mjModel *GetModel() const { return Model; }
+
+	/** @brief Data of one instance for direct C++ access, or nullptr if Index is out of range */
+	mjData *GetData(int32 Index) const { return Datas.IsValidIndex(Index) ? Datas[Index] : nullptr; }
+
+private:
+	mjModel *Model = nullptr;
+	TArray<mjData *> Datas;
+};
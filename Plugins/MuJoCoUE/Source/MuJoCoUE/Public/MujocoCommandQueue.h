@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "mujoco/mujoco.h"
+
+#include "CoreMinimal.h"
+#include "Containers/CircularQueue.h"
+
+/**
+ * @enum EMujocoCommandType
+ * @brief Kinds of requests the game thread can send to the thread that owns mjData.
+ */
+enum class EMujocoCommandType : uint8
+{
+	SetControls,  // Data holds the full nu control vector
+	Reset,        // mj_resetData
+	SetPaused,    // bFlag is the new paused state
+	Step,         // one mj_step, also while paused
+	LoadKeyframe, // Index is the keyframe id
+	SetState      // Data holds nq qpos values, Data2 holds nv qvel values
+};
+
+/**
+ * @struct FMujocoCommand
+ * @brief One request applied by the worker between two mj_step calls.
+ */
+struct FMujocoCommand
+{
+	EMujocoCommandType Type = EMujocoCommandType::Step;
+	int32 Index = 0;
+	bool bFlag = false;
+	TArray<mjtNum> Data;
+	TArray<mjtNum> Data2;
+
+	FMujocoCommand() = default;
+	explicit FMujocoCommand(EMujocoCommandType InType) : Type(InType) {}
+};
+
+/**
+ * @class FMujocoCommandQueue
+ * @brief Bounded single-producer/single-consumer command ring.
+ *
+ * The game thread is the only producer and the simulation worker the only consumer.
+ * Neither side ever blocks: Enqueue fails when the ring is full and Dequeue fails
+ * when it is empty.
+ */
+class FMujocoCommandQueue
+{
+public:
+	static constexpr uint32 Capacity = 256;
+
+	FMujocoCommandQueue() : Queue(Capacity) {}
+
+	/** @brief Producer only. Returns false if the ring is full. */
+	bool Enqueue(FMujocoCommand &&Command) { return Queue.Enqueue(MoveTemp(Command)); }
+
+	/** @brief Consumer only. Returns false if the ring is empty. */
+	bool Dequeue(FMujocoCommand &OutCommand) { return Queue.Dequeue(OutCommand); }
+
+	/** @brief Consumer only. Drops every pending command. */
+	void Empty() { Queue.Empty(); }
+
+private:
+	TCircularQueue<FMujocoCommand> Queue;
+};
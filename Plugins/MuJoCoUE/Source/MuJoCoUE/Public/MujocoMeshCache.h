@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "mujoco/mujoco.h"
+
+#include "CoreMinimal.h"
+#include "MeshDescription.h"
+#include "Templates/Function.h"
+
+/**
+ * @brief Persistent cache of the mesh descriptions built by MujocoMeshConversion.
+ *
+ * One file per model under Saved/MuJoCo/MeshCache, named after a hash of all of the model's
+ * mesh arrays. It holds the final vertex positions, triangle corners and per corner normals,
+ * tangents and UVs, so a later load rebuilds the descriptions without converting anything or
+ * computing tangents. Files are memory-mapped for reading. A file written by another cache
+ * version or for other mesh data is ignored and rewritten.
+ */
+namespace MujocoMeshCache
+{
+	/** Hash of every mesh of Model (MujocoMeshConversion::HashMesh) and of the cache version. */
+	MUJOCOUE_API uint64 HashModelMeshes(const mjModel *Model);
+
+	/** Cache file of the model whose meshes hash to ModelHash. */
+	MUJOCOUE_API FString GetCachePath(uint64 ModelHash);
+
+	/** Writes Meshes (one per mesh id, empty for meshes without data) to Path. */
+	MUJOCOUE_API bool Save(const FString &Path, uint64 ModelHash, const TArray<FMeshDescription> &Meshes);
+
+	/** Reads the NumMeshes descriptions from Path into Out. False if the file is missing, stale or corrupt. */
+	MUJOCOUE_API bool Load(const FString &Path, uint64 ModelHash, int32 NumMeshes, TArray<FMeshDescription> &Out);
+
+	/**
+	 * MujocoMeshConversion::BuildMeshDescriptions through the cache: loads the model's cache
+	 * file if it is valid, otherwise builds every mesh and writes the file. OnConverted is
+	 * called once per mesh either way. Safe on any thread.
+	 */
+	MUJOCOUE_API void BuildMeshDescriptions(const mjModel *Model, TArray<FMeshDescription> &Out, TFunctionRef<void(int32 MeshId)> OnConverted);
+}
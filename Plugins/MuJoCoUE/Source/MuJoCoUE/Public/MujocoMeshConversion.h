@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "mujoco/mujoco.h"
+
+#include "CoreMinimal.h"
+#include "MeshDescription.h"
+#include "ProceduralMeshComponent.h"
+#include "Templates/Function.h"
+
+/**
+ * @struct FMujocoConvertedMesh
+ * @brief Vertex data of one MuJoCo mesh in Unreal form, ready for a mesh section.
+ *
+ * Positions are in centimetres with Y mirrored and the winding swapped accordingly;
+ * normals and tangents are derived from the faces, UVs are a constant placeholder.
+ */
+struct MUJOCOUE_API FMujocoConvertedMesh
+{
+	TArray<FVector> Vertices;
+	TArray<int32> Triangles;
+	TArray<FVector> Normals;
+	TArray<FVector2D> UVs;
+	TArray<FProcMeshTangent> Tangents;
+
+	/** True for meshes without vertices or faces, which are not drawn */
+	bool IsEmpty() const { return Triangles.Num() == 0; }
+};
+
+/**
+ * @brief Helpers for turning MuJoCo meshes (mjModel::mesh_*) into Unreal meshes.
+ *
+ * The conversion functions only read the model and touch no UObject, so they may run on any thread.
+ */
+namespace MujocoMeshConversion
+{
+	/**
+	 * Hash of the vertex, face, normal and texture coordinate data of mesh MeshId.
+	 *
+	 * Identical meshes give identical hashes whichever model or mesh id they come from, so
+	 * the hash identifies a converted mesh across simulations.
+	 */
+	MUJOCOUE_API uint64 HashMesh(const mjModel *Model, int32 MeshId);
+
+	/** Converts mesh MeshId into Out, leaving it empty if the mesh has no vertices or faces. */
+	MUJOCOUE_API void ConvertMesh(const mjModel *Model, int32 MeshId, FMujocoConvertedMesh &Out);
+
+	/**
+	 * Converts every mesh of Model into Out (one entry per mesh id), one mesh per task graph task.
+	 * Returns once all are done. OnConverted is called from the converting thread after each mesh.
+	 */
+	MUJOCOUE_API void ConvertMeshes(const mjModel *Model, TArray<FMujocoConvertedMesh> &Out, TFunctionRef<void(int32 MeshId)> OnConverted);
+
+	/**
+	 * Builds a static mesh description of mesh MeshId straight from mesh_vert, mesh_face,
+	 * mesh_normal and mesh_texcoord, with the same axis and winding conventions as ConvertMesh.
+	 * Normals come from the model (computed if it has none), tangents are computed.
+	 * @return false, leaving Out empty, if the mesh has no vertices or faces
+	 */
+	MUJOCOUE_API bool BuildMeshDescription(const mjModel *Model, int32 MeshId, FMeshDescription &Out);
+
+	/** BuildMeshDescription for every mesh of Model, in parallel like ConvertMeshes. */
+	MUJOCOUE_API void BuildMeshDescriptions(const mjModel *Model, TArray<FMeshDescription> &Out, TFunctionRef<void(int32 MeshId)> OnConverted);
+}
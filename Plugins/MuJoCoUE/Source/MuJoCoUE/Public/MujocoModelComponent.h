@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/PrimitiveComponent.h"
+#include "MujocoModelComponent.generated.h"
+
+struct FMujocoPoseBuffer;
+class UStaticMesh;
+class UMaterialInterface;
+
+/**
+ * @struct FMujocoModelGeom
+ * @brief One geom drawn by a UMujocoModelComponent.
+ *
+ * @var Mesh     Static mesh whose LOD 0 is drawn.
+ * @var Material Material of every section; the mesh's own materials if null.
+ * @var Scale    Geom scale applied on top of the pose.
+ * @var Color    Passed to the material as its BaseColor vector parameter.
+ * @var GeomId   MuJoCo id of the geom, indexing FMujocoPoseBuffer::Geom*.
+ */
+USTRUCT()
+struct MUJOCOUE_API FMujocoModelGeom
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UStaticMesh *Mesh = nullptr;
+
+	UPROPERTY()
+	UMaterialInterface *Material = nullptr;
+
+	UPROPERTY()
+	FVector Scale = FVector::OneVector;
+
+	UPROPERTY()
+	FLinearColor Color = FLinearColor::White;
+
+	UPROPERTY()
+	int32 GeomId = INDEX_NONE;
+};
+
+/**
+ * @brief Primitive component that draws every geom of one simulation through a single scene proxy.
+ *
+ * The proxy keeps each geom's transform on the render thread and builds the mesh batches for
+ * the static meshes' LOD 0 itself; it is culled as a whole by its bounds. Per frame the game thread
+ * only hands over the geoms that moved, in one render command, however many geoms the model has.
+ *
+ * Poses are in the component's space, which is the MuJoCo world frame when the component sits
+ * on the actor root with an identity relative transform.
+ */
+UCLASS(ClassGroup = (MuJoCo))
+class MUJOCOUE_API UMujocoModelComponent : public UPrimitiveComponent
+{
+	GENERATED_BODY()
+
+public:
+	UMujocoModelComponent();
+
+	/** @brief Sets the geoms to draw and recreates the render state. Call from the game thread. */
+	void SetGeoms(const TArray<FMujocoModelGeom> &InGeoms);
+
+	/**
+	 * @brief Sends the poses of the geoms flagged dirty to the scene proxy in one render command
+	 *
+	 * Does nothing if no drawn geom moved. Bounds are only refreshed when the geoms leave the
+	 * current (padded) bounds, which costs one extra transform update on the render thread.
+	 *
+	 * @param Poses Pose buffer of the current frame; GeomDirty selects what is sent
+	 */
+	void UpdatePoses(const FMujocoPoseBuffer &Poses);
+
+	/** @brief Geoms drawn, in draw order */
+	const TArray<FMujocoModelGeom> &GetGeoms() const { return Geoms; }
+
+	/** @brief Padding added around the geoms when the bounds are refreshed, as a fraction of their extent */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MuJoCo|Rendering", meta = (ClampMin = "0.0"))
+	float BoundsSlack = 0.25f;
+
+	//~ Begin UPrimitiveComponent Interface
+	virtual FPrimitiveSceneProxy *CreateSceneProxy() override;
+	virtual FBoxSphereBounds CalcBounds(const FTransform &LocalToWorld) const override;
+	virtual void GetUsedMaterials(TArray<UMaterialInterface *> &OutMaterials, bool bGetDebugMaterials = false) const override;
+	//~ End UPrimitiveComponent Interface
+
+	/** @brief Current component space transform of geom Index (its draw index, not its MuJoCo id) */
+	const FTransform &GetGeomTransform(int32 Index) const { return GeomTransforms[Index]; }
+
+	/** @brief Material drawn for material slot MaterialIndex of geom Index, never null */
+	UMaterialInterface *GetGeomMaterial(int32 Index, int32 MaterialIndex) const;
+
+private:
+	/** Geoms in draw order */
+	UPROPERTY(Transient)
+	TArray<FMujocoModelGeom> Geoms;
+
+	/** Component space transform of every geom, including its scale */
+	TArray<FTransform> GeomTransforms;
+
+	/** Bounding sphere radius of every geom's mesh, already scaled */
+	TArray<double> GeomRadii;
+
+	/** Component space box the proxy's bounds were last computed from: the geoms grown by BoundsSlack */
+	FBox PaddedBox = FBox(ForceInit);
+
+	/** Box around all geoms at their current transforms */
+	FBox ComputeGeomBox() const;
+};
@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "mujoco/mujoco.h"
+
+#include "CoreMinimal.h"
+
+/**
+ * @struct FMujocoPoseBuffer
+ * @brief Structure-of-arrays store of the body and geom poses shown in the current frame.
+ *
+ * Holds only what changes per frame: one contiguous array of positions, one of
+ * orientations and one of dirty flags for bodies and for geoms. Names, sizes, colors
+ * and other static model data stay in ModelInfo and are not touched while running.
+ *
+ * Snapshots are converted in batches by MujocoPoseConversion.
+ * Positions are in Unreal units (cm) in the MuJoCo world frame; orientations are
+ * Unreal quaternions. Dirty flags come from the worker's change detection (MarkMoved)
+ * or from comparing poses (SetBody/SetGeom), and stay set until ClearDirty.
+ *
+ * @var BodyPositions  nbody positions (mjData::xpos * 100).
+ * @var BodyRotations  nbody orientations (mjData::xquat).
+ * @var GeomPositions  ngeom positions (mjData::geom_xpos * 100).
+ * @var GeomRotations  ngeom orientations (mjData::geom_xmat).
+ * @var BodyDirty      nbody flags, non-zero if the body moved.
+ * @var GeomDirty      ngeom flags, non-zero if the geom moved.
+ */
+struct MUJOCOUE_API FMujocoPoseBuffer
+{
+	TArray<FVector> BodyPositions;
+	TArray<FQuat> BodyRotations;
+	TArray<FVector> GeomPositions;
+	TArray<FQuat> GeomRotations;
+	TArray<uint8> BodyDirty;
+	TArray<uint8> GeomDirty;
+
+	/** Sizes every array for the model; all poses start at the origin and dirty. */
+	void Initialize(int32 NumBodies, int32 NumGeoms);
+
+	int32 NumBodies() const { return BodyPositions.Num(); }
+	int32 NumGeoms() const { return GeomPositions.Num(); }
+
+	/** Converts nbody x 3 xpos and nbody x 4 xquat into the body arrays. Does not touch the dirty flags. */
+	void SetBodies(const mjtNum *XPos, const mjtNum *XQuat);
+
+	/** Converts ngeom x 3 geom_xpos and ngeom x 9 geom_xmat into the geom arrays. Does not touch the dirty flags. */
+	void SetGeoms(const mjtNum *XPos, const mjtNum *XMat);
+
+	/**
+	 * Flags the bodies changed after publish index Since, and the geoms on them.
+	 * @param BodyChangeIndex nbody change stamps of a snapshot (FMujocoStateSnapshot::BodyChangeIndex)
+	 * @param GeomBodyId ngeom body ids (mjModel::geom_bodyid)
+	 */
+	void MarkMoved(const uint64 *BodyChangeIndex, uint64 Since, const int *GeomBodyId);
+
+	/** Fraction of geoms (or bodies, without geoms) currently flagged dirty. */
+	float GetDirtyFraction() const;
+
+	/** Stores one already converted body pose, flagging it if it changed. */
+	void SetBody(int32 Index, const FVector &Position, const FQuat &Rotation);
+
+	/** Stores one already converted geom pose, flagging it if it changed. */
+	void SetGeom(int32 Index, const FVector &Position, const FQuat &Rotation);
+
+	/** Marks every body and geom dirty, e.g. after the actor itself moved. */
+	void MarkAllDirty();
+
+	/**
+	 * Holds back the dirty flags of geoms that are not visible so this frame skips them.
+	 * ClearDirty restores them, so the geoms are updated once they become visible again.
+	 * @param Visible ngeom flags, non-zero if the geom should be updated this frame
+	 */
+	void DeferGeoms(const uint8 *Visible);
+
+	/** Clears all dirty flags once the poses were applied, keeping those held back by DeferGeoms. */
+	void ClearDirty();
+
+private:
+	TArray<uint8> DeferredGeomDirty;
+};
@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "mujoco/mujoco.h"
+
+#include "CoreMinimal.h"
+#include "Templates/Function.h"
+
+/**
+ * @brief Batch conversion of MuJoCo poses to Unreal poses.
+ *
+ * Convention used throughout the plugin: MuJoCo and Unreal axes map one to one (both Z-up,
+ * X forward), metres become centimetres, and quaternions are reordered from MuJoCo's
+ * (w, x, y, z) to FQuat's (X, Y, Z, W).
+ *
+ * The batch kernels go through Unreal's VectorRegister4Double abstraction, which compiles
+ * to SSE/AVX on x64, NEON on ARM64 and plain FPU code elsewhere; matrices are converted
+ * four at a time with a branch-free formula. The *Scalar variants are the reference
+ * implementations and handle the tail of every batch.
+ */
+namespace MujocoPoseConversion
+{
+	/** Unreal units per MuJoCo metre */
+	constexpr double UnitsPerMeter = 100.0;
+
+	/** Converts Count positions (3 mjtNum each, metres) to FVector (centimetres). */
+	MUJOCOUE_API void ConvertPositions(const mjtNum *XPos, FVector *OutPositions, int32 Count);
+
+	/** Reorders Count MuJoCo quaternions (w, x, y, z) into FQuat. */
+	MUJOCOUE_API void ConvertQuats(const mjtNum *XQuat, FQuat *OutRotations, int32 Count);
+
+	/** Converts Count row-major 3x3 rotation matrices (9 mjtNum each) to normalized FQuat. */
+	MUJOCOUE_API void ConvertMatrices(const mjtNum *XMat, FQuat *OutRotations, int32 Count);
+
+	/** Scalar reference of ConvertMatrices, same formula one matrix at a time. */
+	MUJOCOUE_API void ConvertMatricesScalar(const mjtNum *XMat, FQuat *OutRotations, int32 Count);
+
+	/**
+	 * Runs Body over [0, Count) in chunks of mujoco.Pose.ChunkSize elements.
+	 *
+	 * Below mujoco.Pose.ParallelThreshold elements it is a single call on the calling thread;
+	 * above, the chunks are spread over the task graph workers with ParallelFor and the call
+	 * returns once all are done. Body must only write to the elements of its chunk.
+	 */
+	MUJOCOUE_API void ForEachChunk(int32 Count, TFunctionRef<void(int32 Start, int32 Num)> Body);
+}
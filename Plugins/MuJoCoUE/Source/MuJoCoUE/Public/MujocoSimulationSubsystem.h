@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "HAL/Event.h"
+#include "HAL/ThreadSafeBool.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "MujocoTypes.h"
+#include <atomic>
+#include "MujocoSimulationSubsystem.generated.h"
+
+class FMujocoWorkerThread;
+class FRunnableThread;
+class FMujocoSchedulerWorker;
+class UStaticMesh;
+
+/**
+ * @struct FMujocoScheduledSimulation
+ * @brief Scheduling state of one simulation registered with UMujocoSimulationSubsystem.
+ *
+ * Only the scheduler worker that won the bBusy flag may call Advance on the stepper or
+ * write the run statistics; everything else is read with relaxed atomics.
+ */
+struct FMujocoScheduledSimulation
+{
+	FMujocoWorkerThread *Stepper = nullptr;
+	int32 HomeWorker = 0;
+
+	/** Wall-clock time (FPlatformTime::Seconds) at which the simulation next wants to run */
+	std::atomic<double> NextDue{0};
+	std::atomic<bool> bBusy{false};
+
+	std::atomic<float> AverageLatencyMs{0};
+	std::atomic<float> MaxLatencyMs{0};
+	std::atomic<float> AverageRunMs{0};
+	std::atomic<float> StepsPerSecond{0};
+	std::atomic<int64> StolenRuns{0};
+
+	/** Throughput sampling window, owned by the worker holding bBusy */
+	double WindowStart = 0;
+	int64 WindowSteps = 0;
+};
+
+/**
+ * @struct FMujocoSchedulerQueue
+ * @brief Simulations homed on one scheduler worker. Other workers steal from it when idle.
+ */
+struct FMujocoSchedulerQueue
+{
+	FCriticalSection Lock;
+	TArray<TSharedPtr<FMujocoScheduledSimulation, ESPMode::ThreadSafe>> Simulations;
+	FEvent *WakeEvent = nullptr;
+};
+
+/**
+ * @class UMujocoSimulationSubsystem
+ * @brief Steps every AMuJoCoSimulation in SharedScheduler mode on a fixed pool of worker threads.
+ *
+ * Each simulation is homed on the least loaded worker and runs at its own pace (real-time
+ * factor, timestep and lag policy of its FMujocoWorkerThread). A worker first runs the most
+ * overdue simulation of its own queue; when none is due it steals the most overdue one from
+ * another worker, so a heavy model occupying one worker does not starve the light models
+ * homed next to it.
+ *
+ * The pool size is mujoco.Scheduler.Workers, or the core count minus
+ * mujoco.Scheduler.ReservedCores when that is 0. Workers start with the first registration.
+ *
+ * It also keeps the static meshes built from MuJoCo meshes, keyed by content hash, so
+ * simulations loading the same mesh share one asset.
+ */
+UCLASS()
+class MUJOCOUE_API UMujocoSimulationSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	/** @brief Starts stepping Stepper on the pool. Game thread only. */
+	void RegisterSimulation(FMujocoWorkerThread *Stepper);
+
+	/** @brief Stops stepping Stepper and waits until no worker is using it. Game thread only. */
+	void UnregisterSimulation(FMujocoWorkerThread *Stepper);
+
+	/** @brief Reads the latency and throughput of Stepper. Returns false if it is not registered. */
+	bool GetSimulationStats(const FMujocoWorkerThread *Stepper, FMujocoSchedulerStats &OutStats) const;
+
+	/** @brief Number of worker threads currently running */
+	UFUNCTION(BlueprintPure, Category = "MuJoCo|Threading")
+	int32 GetNumWorkers() const { return Queues.Num(); }
+
+	/** @brief Number of simulations registered with the scheduler */
+	UFUNCTION(BlueprintPure, Category = "MuJoCo|Threading")
+	int32 GetNumSimulations() const;
+
+	/** @brief Static mesh built for MuJoCo mesh content Hash (MujocoMeshConversion::HashMesh), or null. Game thread only. */
+	UStaticMesh *FindSharedMesh(uint64 Hash) const;
+
+	/** @brief Shares Mesh with every simulation of this world under content hash Hash. Game thread only. */
+	void AddSharedMesh(uint64 Hash, UStaticMesh *Mesh);
+
+	/** @brief Number of distinct meshes shared so far */
+	UFUNCTION(BlueprintPure, Category = "MuJoCo|Rendering")
+	int32 GetNumSharedMeshes() const { return SharedMeshes.Num(); }
+
+private:
+	friend class FMujocoSchedulerWorker;
+
+	void StartWorkers();
+	void StopWorkers();
+
+	/** @brief Main loop of worker WorkerIndex */
+	void RunWorker(int32 WorkerIndex);
+
+	/** @brief Claims the most overdue simulation, own queue first, and reports the earliest due time seen */
+	TSharedPtr<FMujocoScheduledSimulation, ESPMode::ThreadSafe> ClaimDueSimulation(int32 WorkerIndex, double Now, double &OutEarliestDue);
+
+	/** @brief Runs one wake of a claimed simulation and updates its statistics */
+	void RunSimulation(FMujocoScheduledSimulation &Simulation, int32 WorkerIndex);
+
+	TArray<TUniquePtr<FMujocoSchedulerQueue>> Queues;
+	TArray<FMujocoSchedulerWorker *> Runnables;
+	TArray<FRunnableThread *> Threads;
+	FThreadSafeBool bStopWorkers;
+
+	/** Static meshes by MuJoCo mesh content hash; owned by the subsystem so they outlive any one simulation */
+	UPROPERTY(Transient)
+	TMap<uint64, UStaticMesh *> SharedMeshes;
+};
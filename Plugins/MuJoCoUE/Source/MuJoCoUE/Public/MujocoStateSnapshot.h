@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "mujoco/mujoco.h"
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+/**
+ * @struct FMujocoStateSnapshot
+ * @brief A consistent copy of the body and geom poses of one mjData after a step.
+ *
+ * The worker thread fills a snapshot right after mj_step returns, so every array
+ * in it belongs to the same simulation step.
+ *
+ * @var double Time         Simulation time of the step (mjData::time).
+ * @var uint64 StepIndex    Number of steps taken when the snapshot was written.
+ * @var BodyXPos            nbody x 3 body positions (mjData::xpos).
+ * @var BodyXQuat           nbody x 4 body orientations (mjData::xquat).
+ * @var GeomXPos            ngeom x 3 geom positions (mjData::geom_xpos).
+ * @var GeomXMat            ngeom x 9 geom rotation matrices (mjData::geom_xmat).
+ * @var double PublishTime  Wall-clock time (FPlatformTime::Seconds) the snapshot was published at.
+ *
+ * @var uint64 PublishIndex     Number of snapshots published before and including this one.
+ * @var BodyChangeIndex         nbody PublishIndex of the last snapshot in which each body moved
+ *                              by more than the buffer's change threshold.
+ *
+ * When the buffer keeps previous poses, the Prev* arrays and PreviousTime hold the step
+ * right before this one, so the reader can interpolate between the two.
+ */
+struct FMujocoStateSnapshot
+{
+	double Time = 0;
+	uint64 StepIndex = 0;
+	TArray<mjtNum> BodyXPos;
+	TArray<mjtNum> BodyXQuat;
+	TArray<mjtNum> GeomXPos;
+	TArray<mjtNum> GeomXMat;
+
+	double PublishTime = 0;
+	double PreviousTime = 0;
+
+	uint64 PublishIndex = 0;
+	TArray<uint64> BodyChangeIndex;
+	TArray<mjtNum> PrevBodyXPos;
+	TArray<mjtNum> PrevBodyXQuat;
+	TArray<mjtNum> PrevGeomXPos;
+	TArray<mjtNum> PrevGeomXMat;
+
+	/** Allocates the arrays for the sizes of the given model, including the Prev* arrays if requested. */
+	void Initialize(const mjModel *m, bool bWithPrevious = false);
+
+	/** Returns true if the Prev* arrays are allocated. */
+	bool HasPrevious() const { return PrevBodyXPos.Num() == BodyXPos.Num() && BodyXPos.Num() > 0; }
+
+	/** Makes the previous poses equal to the current ones. */
+	void CopyCurrentToPrevious();
+
+	/** Copies the poses of d into the already allocated arrays. */
+	void CopyFrom(const mjData *d);
+};
+
+/**
+ * @class FMujocoSnapshotBuffer
+ * @brief Lock-free triple buffer handing FMujocoStateSnapshot from the worker to the game thread.
+ *
+ * One slot is owned by the writer, one by the reader and the third is the shared
+ * "middle" slot. Publishing swaps the writer slot with the middle one and marks it
+ * fresh; acquiring swaps the reader slot with the middle one if it is fresh. Both
+ * sides only ever do a single atomic exchange, so neither waits on the other and
+ * the reader always sees a complete snapshot.
+ *
+ * Exactly one thread may write (GetWriteSnapshot/Publish) and exactly one thread
+ * may read (AcquireLatest) at a time.
+ */
+class MUJOCOUE_API FMujocoSnapshotBuffer
+{
+public:
+	FMujocoSnapshotBuffer();
+
+	/**
+	 * @brief Sizes all slots for the model and fills them with the current state of d.
+	 * Must be called before the writer and reader threads start using the buffer.
+	 *
+	 * @param bInKeepPrevious Also hand the poses of the previous step with every snapshot
+	 * @param InChangeThreshold Smallest body motion (metres, radians) recorded in BodyChangeIndex
+	 */
+	void Initialize(const mjModel *m, const mjData *d, bool bInKeepPrevious = false, double InChangeThreshold = 0);
+
+	/** @brief Returns the slot the writer may fill. Writer thread only. */
+	FMujocoStateSnapshot &GetWriteSnapshot() { return Slots[WriteIndex]; }
+
+	/** @brief Makes the write slot the newest complete snapshot. Writer thread only. */
+	void Publish();
+
+	/**
+	 * @brief Copies d into the write slot, stamps it and publishes it.
+	 * If previous poses are kept, the poses of the last call are handed along as Prev*.
+	 * Bodies that moved past the change threshold since they last did get this
+	 * publish's index in BodyChangeIndex.
+	 */
+	void Publish(const mjData *d, uint64 StepIndex);
+
+	/**
+	 * @brief Returns the newest complete snapshot. Reader thread only.
+	 *
+	 * The returned snapshot stays valid and unchanged until the next call to AcquireLatest.
+	 */
+	const FMujocoStateSnapshot &AcquireLatest();
+
+	/** @brief Returns true if a snapshot was published since the last AcquireLatest. */
+	bool HasFreshSnapshot() const;
+
+private:
+	static constexpr uint32 IndexMask = 0x3;
+	static constexpr uint32 FreshBit = 0x4;
+
+	FMujocoStateSnapshot Slots[3];
+	std::atomic<uint32> Middle;
+	uint32 WriteIndex;
+	uint32 ReadIndex;
+
+	/** Writer-owned copy of the last published poses, swapped into the Prev* arrays */
+	bool bKeepPrevious;
+	FMujocoStateSnapshot Last;
+
+	/** Writer-owned change detection state: body poses at their last recorded change */
+	double ChangeThreshold;
+	uint64 PublishCount;
+	TArray<mjtNum> ReferenceXPos;
+	TArray<mjtNum> ReferenceXQuat;
+	TArray<uint64> BodyChangeIndex;
+
+	/** Stamps every body that moved past ChangeThreshold with PublishCount */
+	void DetectChanges(const mjData *d);
+};
@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MujocoTypes.generated.h"
+
+/**
+ * @enum EMujocoPacingMode
+ * @brief How the worker thread waits for the next simulation step to become due.
+ *
+ * Sleep     - give the core back to the OS until the step is due (lowest CPU use, ~1 ms jitter).
+ * Yield     - repeatedly yield the time slice (low latency, still shares the core).
+ * SpinWait  - busy-wait with CPU pause instructions (lowest latency, burns a full core).
+ */
+UENUM(BlueprintType)
+enum class EMujocoPacingMode : uint8
+{
+	Sleep,
+	Yield,
+	SpinWait
+};
+
+/**
+ * @enum EMujocoLagPolicy
+ * @brief What the worker does when it cannot catch up within MaxStepsPerWake steps.
+ *
+ * DropTime       - discard the backlog and continue from the current simulation time.
+ * SlowClock      - lower the effective real-time factor until the steps keep up, then recover.
+ * DegradeSolver  - lower the solver iteration count until the steps keep up, then restore it.
+ *                  Falls back to DropTime once the minimum iteration count is reached.
+ *
+ * Both degrading policies undo one level only after a run of on-time wakes that used at most
+ * half the step budget, so a single good wake does not bring the lag straight back.
+ */
+UENUM(BlueprintType)
+enum class EMujocoLagPolicy : uint8
+{
+	DropTime,
+	SlowClock,
+	DegradeSolver
+};
+
+/**
+ * @struct FMujocoLagStats
+ * @brief Counters describing how well the worker thread keeps up with wall-clock time.
+ */
+USTRUCT(BlueprintType)
+struct FMujocoLagStats
+{
+	GENERATED_BODY()
+
+	/** Total number of mj_step calls made by the worker */
+	UPROPERTY(BlueprintReadOnly, Category = "MuJoCo|Threading")
+	int64 TotalSteps = 0;
+
+	/** Number of wakes that used up MaxStepsPerWake while still behind */
+	UPROPERTY(BlueprintReadOnly, Category = "MuJoCo|Threading")
+	int64 LaggedWakes = 0;
+
+	/** Simulated seconds the worker was behind its target after the last wake */
+	UPROPERTY(BlueprintReadOnly, Category = "MuJoCo|Threading")
+	float CurrentLag = 0;
+
+	/** Largest lag seen since the worker started */
+	UPROPERTY(BlueprintReadOnly, Category = "MuJoCo|Threading")
+	float MaxLag = 0;
+
+	/** Simulated seconds discarded by the DropTime policy (or its fallback) */
+	UPROPERTY(BlueprintReadOnly, Category = "MuJoCo|Threading")
+	float DroppedTime = 0;
+
+	/** Real-time factor currently applied, lower than requested while SlowClock is active */
+	UPROPERTY(BlueprintReadOnly, Category = "MuJoCo|Threading")
+	float EffectiveRealTimeFactor = 0;
+
+	/** Solver iterations currently applied, lower than the model's while DegradeSolver is active */
+	UPROPERTY(BlueprintReadOnly, Category = "MuJoCo|Threading")
+	int32 SolverIterations = 0;
+};
+
+/**
+ * @enum EMujocoStepMode
+ * @brief Which thread advances the simulation of an AMuJoCoSimulation actor.
+ *
+ * DedicatedThread  - one FRunnableThread per actor, paced by PacingMode.
+ * SharedScheduler  - stepped by the fixed worker pool of UMujocoSimulationSubsystem.
+ * Pipelined        - deterministic: each Tick starts a task simulating the next frame
+ *                    (FixedDeltaTime) while the game thread shows the frame finished last Tick.
+ * Lockstep         - Tick itself runs the whole steps that fit in DeltaTime on the game thread,
+ *                    carrying the leftover fraction to the next Tick; time beyond MaxSubstepsPerTick
+ *                    is dropped. No thread wake-ups, for tests, capture and models too small to be
+ *                    worth a thread.
+ */
+UENUM(BlueprintType)
+enum class EMujocoStepMode : uint8
+{
+	DedicatedThread,
+	SharedScheduler,
+	Pipelined,
+	Lockstep
+};
+
+/**
+ * @struct FMujocoSchedulerStats
+ * @brief Per-simulation latency and throughput measured by UMujocoSimulationSubsystem.
+ */
+USTRUCT(BlueprintType)
+struct FMujocoSchedulerStats
+{
+	GENERATED_BODY()
+
+	/** Average delay between a step becoming due and a worker picking it up, in milliseconds */
+	UPROPERTY(BlueprintReadOnly, Category = "MuJoCo|Threading")
+	float AverageLatencyMs = 0;
+
+	/** Largest pick-up delay seen, in milliseconds */
+	UPROPERTY(BlueprintReadOnly, Category = "MuJoCo|Threading")
+	float MaxLatencyMs = 0;
+
+	/** Average time a worker spends in one wake of this simulation, in milliseconds */
+	UPROPERTY(BlueprintReadOnly, Category = "MuJoCo|Threading")
+	float AverageRunMs = 0;
+
+	/** mj_step calls per wall-clock second */
+	UPROPERTY(BlueprintReadOnly, Category = "MuJoCo|Threading")
+	float StepsPerSecond = 0;
+
+	/** Number of wakes run by a worker other than the simulation's home worker */
+	UPROPERTY(BlueprintReadOnly, Category = "MuJoCo|Threading")
+	int64 StolenRuns = 0;
+};
+
+/**
+ * @enum EMujocoGeomRenderMode
+ * @brief How the geoms of a simulation are turned into rendered primitives.
+ *
+ * StaticMeshComponents - one UStaticMeshComponent per geom, attached to its body.
+ * InstancedMeshes      - one UInstancedStaticMeshComponent per (mesh, material) pair; each geom
+ *                        is an instance carrying its color in per-instance custom data 0..3.
+ * SingleProxy          - one UMujocoModelComponent drawing every geom through a single scene proxy;
+ *                        moved geoms reach the render thread in one render command per frame.
+ */
+UENUM(BlueprintType)
+enum class EMujocoGeomRenderMode : uint8
+{
+	StaticMeshComponents,
+	InstancedMeshes,
+	SingleProxy
+};
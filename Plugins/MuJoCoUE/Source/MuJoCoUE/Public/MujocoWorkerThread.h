@@ -1,24 +1,112 @@
+#pragma once
 
 #include "HAL/Runnable.h"
 #include "HAL/RunnableThread.h"
 #include "HAL/ThreadSafeBool.h"
 #include "HAL/ThreadSafeCounter.h"
 #include "HAL/PlatformProcess.h"
+#include "MujocoStateSnapshot.h"
+#include "MujocoCommandQueue.h"
+#include "MujocoTypes.h"
+#include <atomic>
+
+// 工作线程的调度参数
+struct FMujocoWorkerSettings
+{
+    // 等待下一步时使用的方式
+    EMujocoPacingMode PacingMode = EMujocoPacingMode::Sleep;
+    // 仿真时间/真实时间的比例, <= 0 表示尽可能快
+    float RealTimeFactor = 1.0f;
+    // 每次唤醒最多执行的步数, <= 0 表示不限制
+    int32 MaxStepsPerWake = 100;
+    // 超出步数预算后的追赶策略
+    EMujocoLagPolicy LagPolicy = EMujocoLagPolicy::DropTime;
+    // DegradeSolver 策略允许的最少求解器迭代次数
+    int32 MinSolverIterations = 4;
+};
 
 // 自定义线程类
+// 既可以作为独立线程运行 (Run), 也可以由 UMujocoSimulationSubsystem 的共享线程池调用 Advance
 class FMujocoWorkerThread : public FRunnable
 {
 public:
-    FMujocoWorkerThread(mjData& InSharedmData, mjModel& InSharedmModel, FThreadSafeBool& InStopCondition, FThreadSafeCounter& InRunCount);
-    virtual ~FMujocoWorkerThread() {}
+    FMujocoWorkerThread(mjData& InSharedmData, mjModel& InSharedmModel, FThreadSafeBool& InStopCondition, FThreadSafeCounter& InRunCount, FMujocoSnapshotBuffer& InSnapshots, FMujocoCommandQueue& InCommands, const FMujocoWorkerSettings& InSettings);
+    virtual ~FMujocoWorkerThread();
 
     // FRunnable接口实现
     virtual uint32 Run() override;
     virtual void Stop() override;
 
+    // 由调度器驱动时使用: 开始/结束前各调用一次, Advance 一次只能在一个线程中调用
+    void BeginStepping();
+    void EndStepping();
+    // 执行命令并按速率步进, 返回下一步到期的真实时间 (FPlatformTime::Seconds), 0 表示马上到期
+    double Advance();
+    // 确定性地执行命令和固定的步数, 不参考真实时间 (流水线/锁步模式), 最后发布一次快照
+    void StepFixed(int32 NumSteps);
+
+    // 可以在任意线程调用, 下一次唤醒时生效
+    void SetPacingMode(EMujocoPacingMode InMode);
+    void SetRealTimeFactor(float InRealTimeFactor);
+
+    // 线程安全地读取滞后统计
+    FMujocoLagStats GetLagStats() const;
+    int64 GetTotalSteps() const { return StatTotalSteps.load(std::memory_order_relaxed); }
+
 private:
+    // 按照 PacingMode 等待到给定的真实时间 (FPlatformTime::Seconds)
+    void WaitUntil(double WakeTime, EMujocoPacingMode Mode) const;
+
+    // 在两步之间执行游戏线程发来的所有命令, 如果时间基准被改变(重置/暂停等)返回 true
+    bool ApplyCommands();
+    void ApplyCommand(FMujocoCommand& Command);
+    // 修改状态后重新计算位姿并发布快照
+    void PublishForward();
+
+    // 让真实时间 Now 对应仿真时间 SimTime, 之后按 Factor 的速率前进
+    void Rebase(double Now, double SimTime, float Factor);
+    // 步数预算用完仍然落后时按 LagPolicy 处理
+    void HandleLag(double Lag, double Now, double TargetTime);
+    // 连续多次准时且有余量后逐步恢复速率和求解器迭代次数, Steps 是本次唤醒执行的步数
+    void Recover(double Now, double TargetTime, int32 Steps);
+    // 丢弃落后的时间, 从当前仿真时间继续
+    void DropBacklog(double Lag, double Now);
+
     mjData* SharedmData;
+    // 步进使用的模型: DegradeSolver 策略下是工作线程私有的副本, 修改迭代次数不会影响游戏线程读取的共享模型
     mjModel* SharedmModel;
+    bool bOwnsModel;
     FThreadSafeBool& StopCondition;
     FThreadSafeCounter& RunCount;
+    // 每步之后发布位姿快照给游戏线程
+    FMujocoSnapshotBuffer& Snapshots;
+    uint64 StepCount;
+    // 游戏线程发来的命令, 只在两步之间执行
+    FMujocoCommandQueue& Commands;
+    FMujocoCommand PendingCommand;
+    bool bPaused;
+
+    std::atomic<EMujocoPacingMode> PacingMode;
+    std::atomic<float> RealTimeFactor;
+    const int32 MaxStepsPerWake;
+    const EMujocoLagPolicy LagPolicy;
+    const int32 MinSolverIterations;
+    int32 ModelSolverIterations;
+
+    // 以下只在工作线程中使用
+    double WallStart;
+    double SimStart;
+    float RequestedFactor;
+    float EffectiveFactor;
+    // 连续准时且有余量的唤醒次数, 落后时清零
+    int32 OnTimeWakes;
+
+    // 滞后统计, 工作线程写, 其它线程读
+    std::atomic<int64> StatTotalSteps;
+    std::atomic<int64> StatLaggedWakes;
+    std::atomic<double> StatCurrentLag;
+    std::atomic<double> StatMaxLag;
+    std::atomic<double> StatDroppedTime;
+    std::atomic<float> StatEffectiveFactor;
+    std::atomic<int32> StatSolverIterations;
 };